@@ -0,0 +1,96 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stringset.h"
+
+
+// The number of passes over the strings made by timing functions.
+#define PASSES 3
+
+
+static uint64_t
+next_random(uint64_t *state)
+{
+    uint64_t x = (*state += UINT64_C(0x9e3779b97f4a7c15));
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return x ^ (x >> 31);
+}
+
+
+char **
+alloc_random_strings(int count, unsigned seed)
+{
+    char **strings = malloc(sizeof(char *) * count);
+    assert(strings);
+    
+    uint64_t state = seed;
+    for (int i = 0; i < count; ++i) {
+        strings[i] = malloc(17);
+        assert(strings[i]);
+        snprintf(strings[i], 17, "%016llx",
+                 (unsigned long long)next_random(&state));
+    }
+    return strings;
+}
+
+
+struct stringset *
+alloc_stringset(char **strings, int count)
+{
+    struct stringset *stringset = stringset_alloc();
+    assert(stringset);
+    
+    int result = stringset_set_deferred(stringset, true);
+    assert(0 == result);
+    result = stringset_add_array(stringset, (char const *const *)strings, count);
+    assert(0 == result);
+    result = stringset_set_deferred(stringset, false);
+    assert(0 == result);
+    
+    return stringset;
+}
+
+
+void
+free_strings(char **strings, int count)
+{
+    for (int i = 0; i < count; ++i) free(strings[i]);
+    free(strings);
+}
+
+
+double
+now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+
+double
+time_contains(struct stringset const *stringset,
+              char **strings,
+              int count,
+              bool expected)
+{
+    int mismatches = 0;
+    double start = now();
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (int i = 0; i < count; ++i) {
+            if (stringset_contains(stringset, strings[i]) != expected) {
+                ++mismatches;
+            }
+        }
+    }
+    double elapsed = now() - start;
+    assert(!mismatches);
+    
+    return elapsed * 1e9 / ((double)PASSES * count);
+}
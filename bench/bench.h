@@ -0,0 +1,97 @@
+#ifndef BENCH_H_INCLUDED
+#define BENCH_H_INCLUDED
+
+
+#include <stdbool.h>
+
+
+struct stringset;
+
+
+// Hardware performance counters.  A counter is unavailable when the platform,
+// kernel or hardware doesn't provide it, or when the process isn't permitted
+// to use it.
+enum counter {
+    counter_cycles,
+    counter_instructions,
+    counter_l1d_misses,
+    counter_llc_misses,
+    counter_branch_misses,
+    counter_dtlb_misses,
+    counter_count
+};
+
+// A set of counters of user space events of the calling thread.  `fds' is -1
+// for an unavailable counter and `values' holds the events counted between
+// calls to `counters_start()' and `counters_stop()' since the last
+// `counters_reset()'.
+struct counters {
+    int fds[counter_count];
+    unsigned long long values[counter_count];
+};
+
+extern char const *const counter_names[counter_count];
+
+
+// Allocate `count' distinct random strings of 16 hexadecimal digits.  The
+// same `seed' produces the same strings.  Free with `free_strings()'.
+char **
+alloc_random_strings(int count, unsigned seed);
+
+// Allocate a string set from an array of strings using deferred insertion.
+struct stringset *
+alloc_stringset(char **strings, int count);
+
+// Free strings allocated by `alloc_random_strings()'.
+void
+free_strings(char **strings, int count);
+
+// The current time of a monotonic clock in seconds.
+double
+now(void);
+
+// Open the counters and reset their values.  Return false if no counter is
+// available; the other counter functions still work, counting nothing.
+bool
+counters_open(struct counters *counters);
+
+void
+counters_close(struct counters *counters);
+
+void
+counters_reset(struct counters *counters);
+
+void
+counters_start(struct counters *counters);
+
+// Stop counting and add the events counted since `counters_start()' to the
+// values.
+void
+counters_stop(struct counters *counters);
+
+// Call `stringset_contains()' for each string and return the average time
+// per call in nanoseconds.  `expected' is the result every call must return.
+double
+time_contains(struct stringset const *stringset,
+              char **strings,
+              int count,
+              bool expected);
+
+
+void
+bench_concurrent(void);
+
+void
+bench_counters(void);
+
+void
+bench_filter(void);
+
+void
+bench_index(void);
+
+void
+bench_sharded(void);
+
+
+#endif
@@ -0,0 +1,141 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include "stringset.h"
+#include "stringset_concurrent.h"
+
+
+// The most threads a benchmark runs.
+#define MAX_THREADS_COUNT 32
+
+
+// A deferred string set behind one mutex, the alternative to the lock-free
+// set.
+struct locked {
+    pthread_mutex_t lock;
+    struct stringset *stringset;
+};
+
+
+struct worker {
+    struct locked *locked;
+    struct stringset_concurrent *concurrent;
+    char **strings;
+    int strings_count;
+    int first;
+    int count;
+};
+
+
+static void *
+work_locked(void *context)
+{
+    struct worker *worker = context;
+    for (int i = worker->first; i < worker->first + worker->count; ++i) {
+        char const *string = worker->strings[i % worker->strings_count];
+        pthread_mutex_lock(&worker->locked->lock);
+        int result = stringset_add(worker->locked->stringset, string);
+        pthread_mutex_unlock(&worker->locked->lock);
+        assert(0 == result);
+    }
+    return NULL;
+}
+
+
+static void *
+work_concurrent(void *context)
+{
+    struct worker *worker = context;
+    for (int i = worker->first; i < worker->first + worker->count; ++i) {
+        char const *string = worker->strings[i % worker->strings_count];
+        int result = stringset_concurrent_add(worker->concurrent, string);
+        assert(-1 != result);
+    }
+    return NULL;
+}
+
+
+// Split `adds_count' adds among `threads_count' workers and return the adds
+// per second.
+static double
+run_workers(void *(*work)(void *),
+            struct worker const *template,
+            int adds_count,
+            int threads_count)
+{
+    assert(threads_count <= MAX_THREADS_COUNT);
+    pthread_t threads[MAX_THREADS_COUNT];
+    struct worker workers[MAX_THREADS_COUNT];
+    int count = adds_count / threads_count;
+    
+    double start = now();
+    for (int i = 0; i < threads_count; ++i) {
+        workers[i] = *template;
+        workers[i].first = i * count;
+        workers[i].count = count;
+        int result = pthread_create(&threads[i], NULL, work, &workers[i]);
+        assert(0 == result);
+    }
+    for (int i = 0; i < threads_count; ++i) {
+        int result = pthread_join(threads[i], NULL);
+        assert(0 == result);
+    }
+    double elapsed = now() - start;
+    return threads_count * (double)count / elapsed;
+}
+
+
+// Compare the throughput of deduplicating strings with a mutex-protected
+// deferred string set and with a concurrent string set as the adds are split
+// among more threads.  Each string is added four times.
+void
+bench_concurrent(void)
+{
+    int const strings_count = 100000;
+    int const adds_count = 4 * strings_count;
+    int const threads_counts[] = { 1, 2, 4, 8, 16, 32 };
+    int threads_counts_count = sizeof threads_counts / sizeof threads_counts[0];
+    
+    char **strings = alloc_random_strings(strings_count, 1);
+    
+    printf("concurrent: %i strings, %i adds, adds per second\n",
+           strings_count, adds_count);
+    printf("%10s %14s %14s %8s\n",
+           "threads", "locked", "concurrent", "speedup");
+    for (int i = 0; i < threads_counts_count; ++i) {
+        struct locked locked;
+        int result = pthread_mutex_init(&locked.lock, NULL);
+        assert(0 == result);
+        locked.stringset = stringset_alloc();
+        assert(locked.stringset);
+        result = stringset_set_deferred(locked.stringset, true);
+        assert(0 == result);
+        struct stringset_concurrent *concurrent = stringset_concurrent_alloc(0);
+        assert(concurrent);
+        
+        struct worker template = {
+            &locked, concurrent, strings, strings_count, 0, 0
+        };
+        double locked_rate = run_workers(work_locked,
+                                         &template,
+                                         adds_count,
+                                         threads_counts[i]);
+        double concurrent_rate = run_workers(work_concurrent,
+                                             &template,
+                                             adds_count,
+                                             threads_counts[i]);
+        printf("%10i %14.0f %14.0f %7.1fx\n",
+               threads_counts[i], locked_rate, concurrent_rate,
+               concurrent_rate / locked_rate);
+        
+        assert(strings_count == stringset_concurrent_count(concurrent));
+        stringset_concurrent_free(concurrent);
+        stringset_free(locked.stringset);
+        pthread_mutex_destroy(&locked.lock);
+    }
+    
+    free_strings(strings, strings_count);
+}
@@ -0,0 +1,207 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "stringset.h"
+
+
+// The operands of the measured operations.  `stringset' and `copy' have the
+// same members; `probes' are strings that aren't members.
+struct operands {
+    struct stringset *stringset;
+    struct stringset *copy;
+    struct stringset *indexed;
+    char **members;
+    char **probes;
+    int count;
+};
+
+
+// A measured operation.  `run' performs a batch of operations and returns how
+// many it performed.
+struct operation {
+    char const *name;
+    int (*run)(struct operands *operands);
+};
+
+
+static int
+run_contains_hit(struct operands *operands)
+{
+    int hits = 0;
+    for (int i = 0; i < operands->count; ++i) {
+        hits += stringset_contains(operands->stringset, operands->members[i]);
+    }
+    assert(operands->count == hits);
+    return operands->count;
+}
+
+
+static int
+run_contains_miss(struct operands *operands)
+{
+    int hits = 0;
+    for (int i = 0; i < operands->count; ++i) {
+        hits += stringset_contains(operands->stringset, operands->probes[i]);
+    }
+    assert(!hits);
+    return operands->count;
+}
+
+
+static int
+run_contains_indexed(struct operands *operands)
+{
+    int hits = 0;
+    for (int i = 0; i < operands->count; ++i) {
+        hits += stringset_contains(operands->indexed, operands->members[i]);
+    }
+    assert(operands->count == hits);
+    return operands->count;
+}
+
+
+// Adding a member sorts the members, so the batch is smaller for larger sets.
+static int
+run_add_remove(struct operands *operands)
+{
+    int count = 1000000 / operands->count;
+    if (count < 1) count = 1;
+    if (count > operands->count) count = operands->count;
+    for (int i = 0; i < count; ++i) {
+        int result = stringset_add(operands->stringset, operands->probes[i]);
+        assert(0 == result);
+        result = stringset_remove(operands->stringset, operands->probes[i]);
+        assert(0 == result);
+    }
+    return count;
+}
+
+
+static int
+run_is_subset_of(struct operands *operands)
+{
+    bool is_subset = stringset_is_subset_of(operands->stringset,
+                                            operands->copy);
+    assert(is_subset);
+    return operands->count;
+}
+
+
+static int
+run_alloc_union(struct operands *operands)
+{
+    struct stringset *result = stringset_alloc_union(operands->stringset,
+                                                     operands->copy);
+    assert(result);
+    stringset_free(result);
+    return operands->count;
+}
+
+
+static int
+run_alloc_intersection(struct operands *operands)
+{
+    struct stringset *result = stringset_alloc_intersection(operands->stringset,
+                                                            operands->copy);
+    assert(result);
+    stringset_free(result);
+    return operands->count;
+}
+
+
+static struct operation const operations[] = {
+    { "contains hit", run_contains_hit },
+    { "contains miss", run_contains_miss },
+    { "contains+index", run_contains_indexed },
+    { "add+remove", run_add_remove },
+    { "is_subset_of", run_is_subset_of },
+    { "alloc_union", run_alloc_union },
+    { "alloc_intersection", run_alloc_intersection },
+};
+
+
+static void
+print_header(void)
+{
+    printf("%18s %10s", "operation", "ns");
+    for (int i = 0; i < counter_count; ++i) {
+        printf(" %13s", counter_names[i]);
+    }
+    printf("\n");
+}
+
+
+// Run an operation once to warm the caches, then measure a second run.
+static void
+measure(struct operation const *operation,
+        struct operands *operands,
+        struct counters *counters)
+{
+    operation->run(operands);
+    
+    counters_reset(counters);
+    double start = now();
+    counters_start(counters);
+    int count = operation->run(operands);
+    counters_stop(counters);
+    double elapsed = now() - start;
+    
+    printf("%18s %10.1f", operation->name, elapsed * 1e9 / count);
+    for (int i = 0; i < counter_count; ++i) {
+        if (-1 == counters->fds[i]) {
+            printf(" %13s", "-");
+        } else {
+            printf(" %13.2f", (double)counters->values[i] / count);
+        }
+    }
+    printf("\n");
+}
+
+
+// Report the time and hardware counter deltas per operation of the core
+// string set functions, for a set that fits in the caches and for one that
+// only fits in main memory.  Set operations are reported per member.  The
+// counters are read around a batch of operations rather than each call, since
+// the system calls would cost more than most of the calls they measure.
+void
+bench_counters(void)
+{
+    struct counters counters;
+    bool is_available = counters_open(&counters);
+    if (!is_available) {
+        printf("counters: hardware counters unavailable, time only\n");
+    }
+    
+    int const sizes[] = { 1000, 1000000 };
+    int sizes_count = sizeof sizes / sizeof sizes[0];
+    int operations_count = sizeof operations / sizeof operations[0];
+    
+    for (int i = 0; i < sizes_count; ++i) {
+        struct operands operands = {
+            .members = alloc_random_strings(sizes[i], 1),
+            .probes = alloc_random_strings(sizes[i], 2),
+            .count = sizes[i],
+        };
+        operands.stringset = alloc_stringset(operands.members, sizes[i]);
+        operands.copy = alloc_stringset(operands.members, sizes[i]);
+        operands.indexed = alloc_stringset(operands.members, sizes[i]);
+        int result = stringset_build_index(operands.indexed);
+        assert(0 == result);
+        
+        printf("counters: %i members, per operation\n", sizes[i]);
+        print_header();
+        for (int j = 0; j < operations_count; ++j) {
+            measure(&operations[j], &operands, &counters);
+        }
+        
+        stringset_free(operands.stringset);
+        stringset_free(operands.copy);
+        stringset_free(operands.indexed);
+        free_strings(operands.members, sizes[i]);
+        free_strings(operands.probes, sizes[i]);
+    }
+    
+    counters_close(&counters);
+}
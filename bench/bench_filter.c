@@ -0,0 +1,50 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "stringset.h"
+
+
+// Compare the time of `stringset_contains()' for strings that aren't members
+// with and without a filter.
+void
+bench_filter(void)
+{
+    int const sizes[] = { 1000, 100000, 1000000 };
+    int sizes_count = sizeof sizes / sizeof sizes[0];
+    int const probes_count = 100000;
+    
+    printf("filter: contains() ns per call, 1%% false positive rate\n");
+    printf("%10s %12s %12s %8s %12s %12s\n",
+           "members", "miss", "miss+filter", "speedup", "hit", "hit+filter");
+    
+    for (int i = 0; i < sizes_count; ++i) {
+        char **members = alloc_random_strings(sizes[i], 1);
+        char **probes = alloc_random_strings(probes_count, 2);
+        struct stringset *stringset = alloc_stringset(members, sizes[i]);
+        int hits_count = sizes[i] < probes_count ? sizes[i] : probes_count;
+        
+        double miss = time_contains(stringset, probes, probes_count, false);
+        double hit = time_contains(stringset, members, hits_count, true);
+        
+        int result = stringset_build_filter(stringset, 0.01);
+        assert(0 == result);
+        double filtered_miss = time_contains(stringset,
+                                             probes,
+                                             probes_count,
+                                             false);
+        double filtered_hit = time_contains(stringset,
+                                            members,
+                                            hits_count,
+                                            true);
+        
+        printf("%10i %12.1f %12.1f %7.1fx %12.1f %12.1f\n",
+               sizes[i], miss, filtered_miss, miss / filtered_miss,
+               hit, filtered_hit);
+        
+        stringset_free(stringset);
+        free_strings(members, sizes[i]);
+        free_strings(probes, probes_count);
+    }
+}
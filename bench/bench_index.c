@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "stringset.h"
+
+
+// Compare the time of `stringset_contains()' with and without a search index
+// for sets that fit in the L1, L2 and last level caches and for sets that
+// only fit in main memory.
+void
+bench_index(void)
+{
+    int const sizes[] = { 1000, 30000, 1000000, 4000000 };
+    int sizes_count = sizeof sizes / sizeof sizes[0];
+    int const probes_count = 1000000;
+    
+    printf("index: contains() ns per call\n");
+    printf("%10s %12s %12s %8s %12s %12s %8s\n",
+           "members", "hit", "hit+index", "speedup",
+           "miss", "miss+index", "speedup");
+    
+    for (int i = 0; i < sizes_count; ++i) {
+        char **members = alloc_random_strings(sizes[i], 1);
+        char **probes = alloc_random_strings(probes_count, 2);
+        struct stringset *stringset = alloc_stringset(members, sizes[i]);
+        int hits_count = sizes[i] < probes_count ? sizes[i] : probes_count;
+        
+        double hit = time_contains(stringset, members, hits_count, true);
+        double miss = time_contains(stringset, probes, probes_count, false);
+        
+        int result = stringset_build_index(stringset);
+        assert(0 == result);
+        double indexed_hit = time_contains(stringset,
+                                           members,
+                                           hits_count,
+                                           true);
+        double indexed_miss = time_contains(stringset,
+                                            probes,
+                                            probes_count,
+                                            false);
+        
+        printf("%10i %12.1f %12.1f %7.1fx %12.1f %12.1f %7.1fx\n",
+               sizes[i], hit, indexed_hit, hit / indexed_hit,
+               miss, indexed_miss, miss / indexed_miss);
+        
+        stringset_free(stringset);
+        free_strings(members, sizes[i]);
+        free_strings(probes, probes_count);
+    }
+}
@@ -0,0 +1,172 @@
+#include "bench.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+
+#include "stringset.h"
+#include "stringset_sharded.h"
+
+
+// The number of shards of the sharded string set.
+#define SHARDS_COUNT 64
+
+// The most threads a benchmark runs.
+#define MAX_THREADS_COUNT 32
+
+// One operation in this many adds and removes a string; the rest are calls
+// to contains.
+#define WRITE_INTERVAL 100
+
+
+// A string set behind one reader-writer lock, the alternative to sharding.
+struct locked {
+    pthread_rwlock_t lock;
+    struct stringset *stringset;
+};
+
+
+struct worker {
+    struct locked *locked;
+    struct stringset_sharded *sharded;
+    char **members;
+    int members_count;
+    char **probes;
+    int operations_count;
+};
+
+
+static void *
+work_locked(void *context)
+{
+    struct worker *worker = context;
+    struct locked *locked = worker->locked;
+    for (int i = 0; i < worker->operations_count; ++i) {
+        if (i % WRITE_INTERVAL) {
+            char const *member = worker->members[i % worker->members_count];
+            pthread_rwlock_rdlock(&locked->lock);
+            bool contains = stringset_contains(locked->stringset, member);
+            pthread_rwlock_unlock(&locked->lock);
+            assert(contains);
+        } else {
+            char const *probe = worker->probes[i / WRITE_INTERVAL];
+            pthread_rwlock_wrlock(&locked->lock);
+            int result = stringset_add(locked->stringset, probe);
+            pthread_rwlock_unlock(&locked->lock);
+            assert(0 == result);
+            pthread_rwlock_wrlock(&locked->lock);
+            result = stringset_remove(locked->stringset, probe);
+            pthread_rwlock_unlock(&locked->lock);
+            assert(0 == result);
+        }
+    }
+    return NULL;
+}
+
+
+static void *
+work_sharded(void *context)
+{
+    struct worker *worker = context;
+    for (int i = 0; i < worker->operations_count; ++i) {
+        if (i % WRITE_INTERVAL) {
+            char const *member = worker->members[i % worker->members_count];
+            bool contains = stringset_sharded_contains(worker->sharded, member);
+            assert(contains);
+        } else {
+            char const *probe = worker->probes[i / WRITE_INTERVAL];
+            int result = stringset_sharded_add(worker->sharded, probe);
+            assert(0 == result);
+            result = stringset_sharded_remove(worker->sharded, probe);
+            assert(0 == result);
+        }
+    }
+    return NULL;
+}
+
+
+// Split the operations of `template' among `threads_count' workers and return
+// the operations per second.
+static double
+run_workers(void *(*work)(void *),
+            struct worker const *template,
+            int threads_count)
+{
+    assert(threads_count <= MAX_THREADS_COUNT);
+    pthread_t threads[MAX_THREADS_COUNT];
+    struct worker workers[MAX_THREADS_COUNT];
+    int operations_count = template->operations_count / threads_count;
+    int probes_count = operations_count / WRITE_INTERVAL + 1;
+    
+    for (int i = 0; i < threads_count; ++i) {
+        workers[i] = *template;
+        workers[i].operations_count = operations_count;
+        workers[i].probes = alloc_random_strings(probes_count, 100 + i);
+    }
+    
+    double start = now();
+    for (int i = 0; i < threads_count; ++i) {
+        int result = pthread_create(&threads[i], NULL, work, &workers[i]);
+        assert(0 == result);
+    }
+    for (int i = 0; i < threads_count; ++i) {
+        int result = pthread_join(threads[i], NULL);
+        assert(0 == result);
+    }
+    double elapsed = now() - start;
+    
+    for (int i = 0; i < threads_count; ++i) {
+        free_strings(workers[i].probes, probes_count);
+    }
+    return threads_count * (double)operations_count / elapsed;
+}
+
+
+// Compare the throughput of a mixed workload of contains, add and remove
+// calls on one locked string set and on a sharded string set as the same
+// operations are split among more threads.
+void
+bench_sharded(void)
+{
+    int const members_count = 30000;
+    int const operations_count = 100000;
+    int const threads_counts[] = { 1, 2, 4, 8, 16, 32 };
+    int threads_counts_count = sizeof threads_counts / sizeof threads_counts[0];
+    
+    char **members = alloc_random_strings(members_count, 1);
+    struct locked locked;
+    int result = pthread_rwlock_init(&locked.lock, NULL);
+    assert(0 == result);
+    locked.stringset = alloc_stringset(members, members_count);
+    struct stringset_sharded *sharded = stringset_sharded_alloc(SHARDS_COUNT,
+                                                                NULL);
+    assert(sharded);
+    for (int i = 0; i < members_count; ++i) {
+        result = stringset_sharded_add(sharded, members[i]);
+        assert(0 == result);
+    }
+    
+    struct worker template = {
+        &locked, sharded, members, members_count, NULL, operations_count
+    };
+    
+    printf("sharded: %i members, %i shards, 1 write in %i, ops per second\n",
+           members_count, SHARDS_COUNT, WRITE_INTERVAL);
+    printf("%10s %14s %14s %8s\n", "threads", "locked", "sharded", "speedup");
+    for (int i = 0; i < threads_counts_count; ++i) {
+        double locked_rate = run_workers(work_locked,
+                                         &template,
+                                         threads_counts[i]);
+        double sharded_rate = run_workers(work_sharded,
+                                          &template,
+                                          threads_counts[i]);
+        printf("%10i %14.0f %14.0f %7.1fx\n",
+               threads_counts[i], locked_rate, sharded_rate,
+               sharded_rate / locked_rate);
+    }
+    
+    stringset_sharded_free(sharded);
+    stringset_free(locked.stringset);
+    pthread_rwlock_destroy(&locked.lock);
+    free_strings(members, members_count);
+}
@@ -0,0 +1,177 @@
+#include "bench.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef __linux__
+
+struct event {
+    uint32_t type;
+    uint64_t config;
+};
+
+
+static uint64_t
+cache_event(uint64_t cache, uint64_t result)
+{
+    return cache
+         | (uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8
+         | result << 16;
+}
+
+
+static struct event
+counter_event(enum counter counter)
+{
+    switch (counter) {
+        case counter_cycles:
+            return (struct event){
+                PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES
+            };
+        case counter_instructions:
+            return (struct event){
+                PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS
+            };
+        case counter_l1d_misses:
+            return (struct event){
+                PERF_TYPE_HW_CACHE,
+                cache_event(PERF_COUNT_HW_CACHE_L1D,
+                            PERF_COUNT_HW_CACHE_RESULT_MISS)
+            };
+        case counter_llc_misses:
+            return (struct event){
+                PERF_TYPE_HW_CACHE,
+                cache_event(PERF_COUNT_HW_CACHE_LL,
+                            PERF_COUNT_HW_CACHE_RESULT_MISS)
+            };
+        case counter_branch_misses:
+            return (struct event){
+                PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES
+            };
+        default:
+            return (struct event){
+                PERF_TYPE_HW_CACHE,
+                cache_event(PERF_COUNT_HW_CACHE_DTLB,
+                            PERF_COUNT_HW_CACHE_RESULT_MISS)
+            };
+    }
+}
+
+
+// Open a disabled counter of user space events of this thread, or return -1
+// if the kernel or hardware doesn't provide it.
+static int
+open_counter(enum counter counter)
+{
+    struct event event = counter_event(counter);
+    struct perf_event_attr attributes;
+    memset(&attributes, 0, sizeof attributes);
+    attributes.size = sizeof attributes;
+    attributes.type = event.type;
+    attributes.config = event.config;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                           | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+}
+
+
+// Read a counter, scaled up for the time it wasn't counting when the kernel
+// multiplexes more counters than the hardware has.
+static unsigned long long
+read_counter(int fd)
+{
+    uint64_t values[3];
+    if (sizeof values != read(fd, values, sizeof values)) return 0;
+    if (!values[2]) return 0;
+    if (values[2] == values[1]) return values[0];
+    return (unsigned long long)((double)values[0] * values[1] / values[2]);
+}
+
+#endif
+
+
+char const *const counter_names[counter_count] = {
+    "cycles",
+    "instructions",
+    "L1d-misses",
+    "LLC-misses",
+    "branch-misses",
+    "dTLB-misses",
+};
+
+
+bool
+counters_open(struct counters *counters)
+{
+    bool is_any_available = false;
+    for (int i = 0; i < counter_count; ++i) {
+#ifdef __linux__
+        counters->fds[i] = open_counter(i);
+#else
+        counters->fds[i] = -1;
+#endif
+        if (-1 != counters->fds[i]) is_any_available = true;
+    }
+    counters_reset(counters);
+    return is_any_available;
+}
+
+
+void
+counters_close(struct counters *counters)
+{
+    for (int i = 0; i < counter_count; ++i) {
+#ifdef __linux__
+        if (-1 != counters->fds[i]) close(counters->fds[i]);
+#endif
+        counters->fds[i] = -1;
+    }
+}
+
+
+void
+counters_reset(struct counters *counters)
+{
+    memset(counters->values, 0, sizeof counters->values);
+}
+
+
+void
+counters_start(struct counters *counters)
+{
+#ifdef __linux__
+    for (int i = 0; i < counter_count; ++i) {
+        if (-1 == counters->fds[i]) continue;
+        ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)counters;
+#endif
+}
+
+
+void
+counters_stop(struct counters *counters)
+{
+#ifdef __linux__
+    for (int i = 0; i < counter_count; ++i) {
+        if (-1 == counters->fds[i]) continue;
+        ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        counters->values[i] += read_counter(counters->fds[i]);
+    }
+#else
+    (void)counters;
+#endif
+}
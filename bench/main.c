@@ -0,0 +1,37 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+
+struct benchmark {
+    char const *name;
+    void (*run)(void);
+};
+
+
+static struct benchmark const benchmarks[] = {
+    { "concurrent", bench_concurrent },
+    { "counters", bench_counters },
+    { "filter", bench_filter },
+    { "index", bench_index },
+    { "sharded", bench_sharded },
+};
+
+
+// Run the benchmarks named on the command line, or all benchmarks if none are
+// named.
+int
+main(int argc, char *argv[])
+{
+    int benchmarks_count = sizeof benchmarks / sizeof benchmarks[0];
+    for (int i = 0; i < benchmarks_count; ++i) {
+        bool is_selected = argc < 2;
+        for (int j = 1; j < argc; ++j) {
+            if (0 == strcmp(argv[j], benchmarks[i].name)) is_selected = true;
+        }
+        if (is_selected) benchmarks[i].run();
+    }
+    
+    return EXIT_SUCCESS;
+}
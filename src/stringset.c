@@ -1,370 +1,3940 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "stringset.h"
+#include "stringset_hash.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// The fewest pending members a deferred string set buffers before merging
+// them into its sorted members.  Larger sets buffer up to an eighth of their
+// count so that each merge is amortized over many adds.
+#define MIN_PENDING_COUNT 64
+
+// Ranges of at most this many strings are sorted by insertion sort.
+#define INSERTION_SORT_COUNT 16
+
+// Arrays whose natural runs are shorter than this on average are sorted from
+// scratch instead of by merging the runs.
+#define MIN_AVERAGE_RUN_COUNT 16
+
+// The number of 64-bit words in a filter block, one 64-byte cache line.
+#define FILTER_BLOCK_WORDS 8
+
+// The fewest members a filter is sized for.
+#define MIN_FILTER_CAPACITY 64
+
+// The most members of a string set, small enough that the size of a members
+// array can't overflow.  Adding beyond it fails with `EOVERFLOW'.
+#define MAX_COUNT (SIZE_MAX / 2 / sizeof(char *))
+
+// The size of a transparent huge page.  Mapped members arrays of at least
+// this size are a whole number of huge pages.
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// The `mmap()' flags of explicit huge pages of `HUGE_PAGE_SIZE', where the
+// system has them.
+#ifdef MAP_HUGETLB
+#ifdef MAP_HUGE_SHIFT
+#define HUGETLB_FLAGS (MAP_HUGETLB | 21 << MAP_HUGE_SHIFT)
+#else
+#define HUGETLB_FLAGS MAP_HUGETLB
+#endif
+#endif
+
+// Member strings shorter than this, counting the terminating NUL, are stored
+// in fixed-size slots of slabs rather than allocated one by one.
+#define SHORT_STRING_SIZE 16
+
+// The number of slots of the first slab of a string set.  Each new slab has
+// twice as many slots as the last, up to `MAX_SLAB_SLOTS'.
+#define MIN_SLAB_SLOTS 8
+#define MAX_SLAB_SLOTS 1024
+
+// The number of 64-bit prefixes in a 64-byte cache line of a search index.
+// The entries three levels below an index entry share one line.
+#define INDEX_LINE_PREFIXES 8
+
+// Iteration prefetches the string of the member this many members ahead, far
+// enough to hide a cache miss behind the work done on the members between.
+#define PREFETCH_DISTANCE 8
+
+// Parallel iteration hands out members to threads in runs of this many.
+#define PARALLEL_RUN_COUNT 256
+
+// The fewest slots in the hash table of an interning pool.
+#define MIN_POOL_CAPACITY 64
+
+// The range of sketch precisions.  A sketch has 2^precision registers.
+#define MIN_SKETCH_PRECISION 4
+#define MAX_SKETCH_PRECISION 18
+
+// The most sketches whose intersection can be estimated.  Inclusion-exclusion
+// estimates the union of each of the 2^count - 1 subsets of the sketches.
+#define MAX_INTERSECTION_SKETCHES 8
+
+
+// The first bytes of a serialized delta: a tag and a format version.  The
+// header is followed by one byte holding the order of the delta's members.
+static unsigned char const delta_header[4] = { 'S', 'S', 'D', 2 };
+
+// The first bytes of a serialized string set, followed by one byte holding
+// its order.  The members are followed by a 4-byte little-endian CRC-32.
+static unsigned char const stringset_header[4] = { 'S', 'S', 'S', 1 };
+
+// The size of the checksum at the end of a serialized string set.
+#define CHECKSUM_SIZE 4
+
+
+// The CRC-32 of each byte value, computed once on first use.
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+
+// A growable byte buffer used for serialization.
+struct buffer {
+    unsigned char *bytes;
+    size_t size;
+    size_t capacity;
+};
+
+
+// A position in the sorted members of one of several string sets being
+// merged.
+struct cursor {
+    struct stringset const *stringset;
+    char **members;
+    size_t count;
+    size_t index;
+};
+
+
+// A member string that isn't interned in a pool, with the number of members
+// of string sets that refer to it.  Clones share member strings until they
+// are freed, possibly on other threads, so the count is atomic.
+struct member_string {
+    size_t reference_count;
+    char bytes[];
+};
+
+
+// A short member string in a slot of a slab.  Its bytes are at the same
+// offset as those of a `struct member_string', its reference count is
+// atomic like theirs, and `index' is the slot's index in its slab.  A free
+// slot holds the next free slot of its slab in place of its bytes.
+struct short_string {
+    uint32_t reference_count;
+    uint32_t index;
+    char bytes[SHORT_STRING_SIZE];
+};
+
+
+// A block of short string slots.  A string set takes slots from its current
+// slab, first those on the free list and then those never used; shared
+// strings may keep older slabs alive after the string set moves on.
+// `live_count' counts the slots in use, plus one while the slab is a string
+// set's current slab, and the slab is freed with `allocator' when it drops
+// to zero.  Shared strings may be freed on any thread, so `live_count' is
+// atomic and `free_slots' is a lock-free stack: any thread pushes slots,
+// and only the string set whose current slab it is pops them, so a popped
+// slot can't be reused under a concurrent pop.
+struct stringset_slab {
+    struct stringset_allocator allocator;
+    size_t live_count;
+    struct short_string *free_slots;
+    int capacity;
+    int used_count;
+    struct short_string slots[];
+};
+
+
+// A read-optimized search index in Eytzinger order: the children of entry
+// `k' are entries `2k' and `2k + 1', counting from 1.  `prefixes' holds the
+// first bytes of each member as an integer that orders like the member, so
+// most steps of a search compare integers without loading the member, and
+// the top levels of every search share the same few cache lines.
+struct stringset_index {
+    void *memory;
+    size_t memory_size;
+    uint64_t *prefixes;
+    char **members;
+    size_t count;
+};
+
+
+// A string interned in a pool, with its hash and the number of members of
+// string sets that refer to it.
+struct pool_string {
+    uint64_t hash;
+    size_t reference_count;
+    char bytes[];
+};
+
+
+// An open addressing hash table of interned strings with linear probing.
+// `capacity' is zero or a power of two at least twice `count'.
+struct stringset_pool {
+    struct pool_string **slots;
+    size_t capacity;
+    size_t count;
+};
+
+
+// A blocked Bloom filter.  Each string sets `hash_count' bits within a
+// single block, so a lookup touches one cache line.
+struct stringset_filter {
+    uint64_t *blocks;
+    size_t block_count;
+    int hash_count;
+    size_t capacity;
+    bool is_stale;
+    double false_positive_rate;
+};
+
+
+// A HyperLogLog sketch.  The high `precision' bits of a string's hash select
+// a register, which holds the most leading zeros plus one seen in the rest of
+// the hashes that selected it.
+struct stringset_sketch {
+    int precision;
+    uint8_t registers[];
+};
+
+
+static char const *const operation_names[stringset_operation_count] = {
+    "alloc",
+    "alloc_with_allocator",
+    "alloc_from_array",
+    "alloc_from_stringset",
+    "free",
+    "contains",
+    "is_disjoint_from",
+    "is_equal_to",
+    "is_proper_subset_of",
+    "is_proper_superset_of",
+    "is_subset_of",
+    "is_superset_of",
+    "add",
+    "add_array",
+    "clear",
+    "compact",
+    "remove",
+    "remove_array",
+    "retain_array",
+    "set_deferred",
+    "flush",
+    "alloc_union",
+    "add_stringset",
+    "alloc_intersection",
+    "retain_stringset",
+    "alloc_difference",
+    "remove_stringset",
+    "alloc_symmetric_difference",
+    "add_stringset_remove_common",
+    "alloc_delta",
+    "alloc_delta_from_bytes",
+    "delta_serialize",
+    "apply_delta",
+    "build_filter",
+    "drop_filter",
+    "attach_sketch",
+    "sketch_alloc_from_stringset",
+    "count_union",
+    "count_intersection",
+    "count_difference",
+    "count_symmetric_difference",
+    "jaccard_similarity",
+    "alloc_union_of",
+    "alloc_intersection_of",
+    "alloc_at_least",
+    "alloc_with_options",
+    "build_index",
+    "drop_index",
+    "for_each",
+    "parallel_for_each",
+    "serialize",
+    "alloc_from_bytes",
+    "add_sorted_array",
+    "alloc_from_sorted_array",
+};
+
+
+#ifdef STRINGSET_STATS
+
+static struct stringset_stats global_stats;
+
+// The stats block of the string set used by the outermost operation in
+// progress on this thread, and the depth of nested operations.
+static __thread struct stringset_stats *current_stats;
+static __thread int operation_depth;
+
+
+static void
+add_count(unsigned long long *counter, unsigned long long count)
+{
+    __atomic_fetch_add(counter, count, __ATOMIC_RELAXED);
+}
+
+
+// Add `count' to `counter' in the global stats and in `stats' if not NULL.
+#define COUNT(stats, counter, count) \
+    do { \
+        struct stringset_stats *stats_ = (stats); \
+        add_count(&global_stats.counter, (count)); \
+        if (stats_) add_count(&stats_->counter, (count)); \
+    } while (0)
+
+
+static int
+begin_operation(struct stringset const *stringset,
+                enum stringset_operation operation)
+{
+    if (!operation_depth) {
+        current_stats = stringset ? stringset->stats : NULL;
+        COUNT(current_stats, calls[operation], 1);
+    }
+    return ++operation_depth;
+}
+
+
+static void
+end_operation(int *depth)
+{
+    (void)depth;
+    if (!--operation_depth) current_stats = NULL;
+}
+
+
+// Count a call to a public operation and attribute comparisons made until
+// the enclosing function returns to the stats of `stringset'.
+#define BEGIN_STATS(stringset, operation) \
+    int operation_depth_ __attribute__((cleanup(end_operation))) \
+        = begin_operation((stringset), (operation))
+
+#else
+
+#define COUNT(stats, counter, count) ((void)0)
+#define BEGIN_STATS(stringset, operation) ((void)0)
+
+#endif
+
+
+#ifdef STRINGSET_TRACE
+
+static stringset_trace_hook begin_hook;
+static stringset_trace_hook end_hook;
+static void *hooks_context;
+
+static unsigned long long
+histograms[stringset_operation_count][STRINGSET_HISTOGRAM_BUCKETS];
+
+// The depth of nested operations in progress on this thread.
+static __thread int trace_depth;
+
+
+// An operation in progress.  Only the outermost operation on a thread is
+// timed and traced.
+struct trace {
+    struct stringset_trace_event event;
+    uint64_t start;
+    bool is_outermost;
+};
+
+
+static uint64_t
+monotonic_nanoseconds(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000 + (uint64_t)time.tv_nsec;
+}
+
+
+static int
+histogram_bucket(uint64_t nanoseconds)
+{
+    if (nanoseconds < 8) return (int)nanoseconds;
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    int bucket = (exponent - 2) * 8 + (int)(nanoseconds >> (exponent - 3)) - 8;
+    return bucket < STRINGSET_HISTOGRAM_BUCKETS
+         ? bucket
+         : STRINGSET_HISTOGRAM_BUCKETS - 1;
+}
+
+
+static struct trace
+begin_trace(struct stringset const *stringset,
+            struct stringset const *other,
+            enum stringset_operation operation)
+{
+    struct trace trace = {
+        { operation, -1, -1, 0 }, 0, !trace_depth++
+    };
+    if (!trace.is_outermost) return trace;
+    
+    if (stringset) trace.event.count = stringset->count;
+    if (other) trace.event.other_count = other->count;
+    if (begin_hook) begin_hook(&trace.event, hooks_context);
+    trace.start = monotonic_nanoseconds();
+    return trace;
+}
+
+
+static void
+end_trace(struct trace *trace)
+{
+    if (trace->is_outermost) {
+        trace->event.nanoseconds = monotonic_nanoseconds() - trace->start;
+        int bucket = histogram_bucket(trace->event.nanoseconds);
+        __atomic_fetch_add(&histograms[trace->event.operation][bucket],
+                           1,
+                           __ATOMIC_RELAXED);
+        if (end_hook) end_hook(&trace->event, hooks_context);
+    }
+    --trace_depth;
+}
+
+
+// Time a call to a public operation and call the trace hooks when it begins
+// and when the enclosing function returns.
+#define BEGIN_TRACE(stringset, other, operation) \
+    struct trace trace_ __attribute__((cleanup(end_trace))) \
+        = begin_trace((stringset), (other), (operation))
+
+#else
+
+#define BEGIN_TRACE(stringset, other, operation) ((void)0)
+
+#endif
+
+
+// Begin a public operation on `stringset' and, for operations on two string
+// sets, `other'.  Either may be NULL.
+#define BEGIN_BINARY_OPERATION(stringset, other, operation) \
+    BEGIN_STATS((stringset), (operation)); \
+    BEGIN_TRACE((stringset), (other), (operation))
+
+#define BEGIN_OPERATION(stringset, operation) \
+    BEGIN_BINARY_OPERATION((stringset), NULL, (operation))
+
+
+static void *
+allocate(struct stringset_allocator const *allocator, size_t size)
+{
+    if (!allocator->allocate) return malloc(size);
+    return allocator->allocate(size, allocator->context);
+}
+
+
+static void
+deallocate(struct stringset_allocator const *allocator, void *memory)
+{
+    if (!allocator->allocate) {
+        free(memory);
+    } else if (allocator->deallocate) {
+        allocator->deallocate(memory, allocator->context);
+    }
+}
+
+
+static void *
+alloc_memory(struct stringset const *stringset, size_t size)
+{
+    COUNT(stringset->stats, bytes_allocated, size);
+    return allocate(&stringset->allocator, size);
+}
+
+
+// Free a block of memory of `size' bytes.
+static void
+free_memory(struct stringset const *stringset, void *memory, size_t size)
+{
+    (void)size;
+    if (memory) COUNT(stringset->stats, bytes_freed, size);
+    deallocate(&stringset->allocator, memory);
+}
+
+
+// Resize a block of memory from `size' bytes to `new_size' bytes.
+static void *
+realloc_memory(struct stringset const *stringset,
+               void *memory,
+               size_t size,
+               size_t new_size)
+{
+    COUNT(stringset->stats, reallocations, 1);
+    if (new_size > size) {
+        COUNT(stringset->stats, bytes_allocated, new_size - size);
+    } else {
+        COUNT(stringset->stats, bytes_freed, size - new_size);
+    }
+    
+    struct stringset_allocator const *allocator = &stringset->allocator;
+    if (!allocator->allocate) return realloc(memory, new_size);
+    if (allocator->reallocate) {
+        return allocator->reallocate(memory, new_size, allocator->context);
+    }
+    
+    void *new_memory = allocator->allocate(new_size, allocator->context);
+    if (!new_memory) return NULL;
+    if (memory) {
+        memcpy(new_memory, memory, size < new_size ? size : new_size);
+        if (allocator->deallocate) {
+            allocator->deallocate(memory, allocator->context);
+        }
+    }
+    return new_memory;
+}
+
+
+// The size of a mapped members array with room for `capacity' members: whole
+// pages, or whole huge pages once the array is as large as one.
+static size_t
+mapped_size(size_t capacity)
+{
+    size_t size = sizeof(char *) * capacity;
+    size_t page_size = HUGE_PAGE_SIZE;
+    if (size < HUGE_PAGE_SIZE) page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+
+// The number of members that fit in a mapped members array.
+static size_t
+mapped_capacity(size_t size)
+{
+    size_t capacity = size / sizeof(char *);
+    return capacity > MAX_COUNT ? MAX_COUNT : capacity;
+}
+
+
+static void
+advise_huge_pages(void *memory, size_t size)
+{
+#ifdef MADV_HUGEPAGE
+    if (size >= HUGE_PAGE_SIZE) madvise(memory, size, MADV_HUGEPAGE);
+#else
+    (void)memory;
+    (void)size;
+#endif
+}
+
+
+// Allocate a members array with room for at least `*capacity' members.  The
+// arrays of string sets that use huge pages are mapped, and `*capacity' is
+// raised to fill the mapping.  Arrays of string sets that use explicit huge
+// pages are mapped from the reserved huge pages once they are as large as
+// one, and in transparent huge pages when none are left.
+static char **
+alloc_members(struct stringset const *stringset, size_t *capacity)
+{
+    if (!stringset->uses_huge_pages) {
+        return alloc_memory(stringset, sizeof(char *) * *capacity);
+    }
+    
+    size_t size = mapped_size(*capacity);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void *members = MAP_FAILED;
+#ifdef HUGETLB_FLAGS
+    if (stringset->uses_explicit_huge_pages && size >= HUGE_PAGE_SIZE) {
+        members = mmap(NULL,
+                       size,
+                       PROT_READ | PROT_WRITE,
+                       flags | HUGETLB_FLAGS,
+                       -1,
+                       0);
+    }
+#endif
+    if (MAP_FAILED == members) {
+        members = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (MAP_FAILED == members) return NULL;
+        advise_huge_pages(members, size);
+    }
+    
+    *capacity = mapped_capacity(size);
+    return members;
+}
+
+
+// Free a members array with room for `capacity' members.
+static void
+free_members(struct stringset const *stringset,
+             char **members,
+             size_t capacity)
+{
+    if (!stringset->uses_huge_pages) {
+        free_memory(stringset, members, sizeof(char *) * capacity);
+    } else if (members) {
+        munmap(members, mapped_size(capacity));
+    }
+}
+
+
+// Resize the members array of a string set to room for at least
+// `new_capacity' members, or free it if `new_capacity' is zero.  Mapped
+// arrays are resized with `mremap()' where it exists, which moves pages
+// instead of copying members.  Arrays in explicit huge pages are copied to a
+// new mapping instead, which may be in huge pages when the old one isn't.
+static int
+resize_members(struct stringset *stringset, size_t new_capacity)
+{
+    if (new_capacity && !stringset->uses_huge_pages) {
+        size_t size = sizeof(char *) * stringset->capacity;
+        size_t new_size = sizeof(char *) * new_capacity;
+        char **new_members = realloc_memory(stringset,
+                                            stringset->members,
+                                            size,
+                                            new_size);
+        if (!new_members) return -1;
+        stringset->members = new_members;
+        stringset->capacity = new_capacity;
+        return 0;
+    }
+    
+    if (!new_capacity || !stringset->members) {
+        char **new_members = NULL;
+        if (new_capacity) {
+            new_members = alloc_members(stringset, &new_capacity);
+            if (!new_members) return -1;
+        }
+        free_members(stringset, stringset->members, stringset->capacity);
+        stringset->members = new_members;
+        stringset->capacity = new_capacity;
+        return 0;
+    }
+    
+    size_t size = mapped_size(stringset->capacity);
+    size_t new_size = mapped_size(new_capacity);
+    if (new_size != size) {
+        char **new_members = NULL;
+#ifdef MREMAP_MAYMOVE
+        if (!stringset->uses_explicit_huge_pages) {
+            void *remapped = mremap(stringset->members,
+                                    size,
+                                    new_size,
+                                    MREMAP_MAYMOVE);
+            if (MAP_FAILED == remapped) return -1;
+            advise_huge_pages(remapped, new_size);
+            new_members = remapped;
+        }
+#endif
+        if (!new_members) {
+            new_members = alloc_members(stringset, &new_capacity);
+            if (!new_members) return -1;
+            memcpy(new_members,
+                   stringset->members,
+                   sizeof(char *) * stringset->count);
+            free_members(stringset, stringset->members, stringset->capacity);
+        }
+        stringset->members = new_members;
+    }
+    stringset->capacity = mapped_capacity(new_size);
+    return 0;
+}
+
+
+static void
+drop_filter(struct stringset *stringset)
+{
+    struct stringset_filter *filter = stringset->filter;
+    if (filter) {
+        size_t blocks_size = sizeof(uint64_t) * FILTER_BLOCK_WORDS
+                           * filter->block_count;
+        free_memory(stringset, filter->blocks, blocks_size);
+        free_memory(stringset, filter, sizeof(struct stringset_filter));
+        stringset->filter = NULL;
+    }
+}
+
+
+static void
+drop_index(struct stringset *stringset)
+{
+    struct stringset_index *index = stringset->index;
+    if (index) {
+        free_memory(stringset, index->memory, index->memory_size);
+        free_memory(stringset, index, sizeof(struct stringset_index));
+        stringset->index = NULL;
+    }
+}
+
+
+// Arena allocators without a `deallocate' function release member strings
+// all at once, so string sets don't need to visit members to free them.
+// Members interned in a pool always release their references.
+static bool
+frees_members(struct stringset const *stringset)
+{
+    return    stringset->pool
+           || !stringset->allocator.allocate
+           || stringset->allocator.deallocate;
+}
+
+
+// Check if a string set shares its members array with clones.  Share counts
+// are atomic because clones of the same string set may be allocated on
+// several threads at once.
+static bool
+is_shared(struct stringset const *stringset)
+{
+    return    stringset->share_count
+           && __atomic_load_n(stringset->share_count, __ATOMIC_ACQUIRE) > 1;
+}
+
+
+// Allocate an empty string set that uses the same allocator, order and
+// interning pool as `stringset'.
+static struct stringset *
+alloc_like(struct stringset const *stringset)
+{
+    struct stringset_options options = {
+        &stringset->allocator,
+        stringset->order,
+        stringset->pool,
+        stringset->uses_huge_pages,
+        stringset->uses_explicit_huge_pages
+    };
+    return stringset_alloc_with_options(&options);
+}
+
+
+// Check that two string sets can be combined: neither is NULL and they have
+// the same order.
+static bool
+are_compatible(struct stringset const *first, struct stringset const *second)
+{
+    return first && second && first->order == second->order;
+}
+
+
+static int
+buffer_append(struct buffer *buffer, void const *bytes, size_t size)
+{
+    if (buffer->size + size > buffer->capacity) {
+        size_t new_capacity = buffer->capacity ? 2 * buffer->capacity : 256;
+        while (new_capacity < buffer->size + size) new_capacity *= 2;
+        unsigned char *new_bytes = realloc(buffer->bytes, new_capacity);
+        if (!new_bytes) return -1;
+        
+        buffer->bytes = new_bytes;
+        buffer->capacity = new_capacity;
+    }
+    
+    memcpy(buffer->bytes + buffer->size, bytes, size);
+    buffer->size += size;
+    return 0;
+}
+
+
+static int
+buffer_append_varint(struct buffer *buffer, size_t value)
+{
+    unsigned char bytes[10];
+    size_t size = 0;
+    do {
+        bytes[size] = value & 0x7f;
+        value >>= 7;
+        if (value) bytes[size] |= 0x80;
+        ++size;
+    } while (value);
+    return buffer_append(buffer, bytes, size);
+}
+
+
+// Append the count and members of a string set.  Each member is front coded
+// as the length of the prefix it shares with the previous member followed by
+// the length and bytes of the rest of the member.
+static int
+buffer_append_members(struct buffer *buffer,
+                      struct stringset const *stringset)
+{
+    if (-1 == buffer_append_varint(buffer, stringset->count)) return -1;
+    
+    char const *previous = "";
+    for (size_t i = 0; i < stringset->count; ++i) {
+        char const *member = stringset->members[i];
+        size_t prefix_length = 0;
+        while (   previous[prefix_length]
+               && previous[prefix_length] == member[prefix_length])
+        {
+            ++prefix_length;
+        }
+        char const *suffix = member + prefix_length;
+        size_t suffix_length = strlen(suffix);
+        
+        if (-1 == buffer_append_varint(buffer, prefix_length)) return -1;
+        if (-1 == buffer_append_varint(buffer, suffix_length)) return -1;
+        if (-1 == buffer_append(buffer, suffix, suffix_length)) return -1;
+        previous = member;
+    }
+    return 0;
+}
+
+
+static void
+fill_crc_table(void)
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = crc & 1 ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+        }
+        crc_table[i] = crc;
+    }
+}
+
+
+// The CRC-32 used by zlib and PNG.
+static uint32_t
+crc32(unsigned char const *bytes, size_t size)
+{
+    pthread_once(&crc_table_once, fill_crc_table);
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < size; ++i) {
+        crc = crc_table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+
+static inline int
+compare_case_folded(char const *first, char const *second)
+{
+    unsigned char const *s1 = (unsigned char const *)first;
+    unsigned char const *s2 = (unsigned char const *)second;
+    while (true) {
+        int c1 = fold_case(*s1++);
+        int c2 = fold_case(*s2++);
+        if (c1 != c2 || !c1) return c1 - c2;
+    }
+}
+
+
+static inline int
+compare_length_first(char const *first, char const *second)
+{
+    size_t first_length = strlen(first);
+    size_t second_length = strlen(second);
+    if (first_length != second_length) {
+        return first_length < second_length ? -1 : 1;
+    }
+    return memcmp(first, second, first_length);
+}
+
+
+// Compare two strings in a string set order.  Callers that pass a constant
+// order get only that order's comparison inlined.
+static inline __attribute__((always_inline)) int
+compare_strings(enum stringset_order order,
+                char const *first,
+                char const *second)
+{
+    COUNT(current_stats, comparisons, 1);
+    if (first == second) return 0;
+    switch (order) {
+        case stringset_order_length_first:
+            return compare_length_first(first, second);
+        case stringset_order_case_folded:
+            return compare_case_folded(first, second);
+        default:
+            return strcmp(first, second);
+    }
+}
+
+
+static inline void
+swap_strings(char **first, char **second)
+{
+    char *string = *first;
+    *first = *second;
+    *second = string;
+}
+
+
+// Sort strings with a quicksort that finishes small ranges with insertion
+// sort.  This is inlined into `sort_strings()' once for each order, so unlike
+// `qsort()' the comparisons are inlined too.
+static inline __attribute__((always_inline)) void
+sort_in_order(enum stringset_order order, char **strings, size_t count)
+{
+    // Partitions waiting to be sorted.  The larger partition is pushed and
+    // the smaller one sorted first, so the stack holds at most log2(count)
+    // partitions.
+    struct {
+        char **strings;
+        size_t count;
+    } stack[CHAR_BIT * sizeof(size_t)];
+    int stack_count = 0;
+    
+    while (true) {
+        while (count > INSERTION_SORT_COUNT) {
+            char **first = strings;
+            char **middle = strings + count / 2;
+            char **last = strings + count - 1;
+            if (compare_strings(order, *middle, *first) < 0) {
+                swap_strings(middle, first);
+            }
+            if (compare_strings(order, *last, *middle) < 0) {
+                swap_strings(last, middle);
+                if (compare_strings(order, *middle, *first) < 0) {
+                    swap_strings(middle, first);
+                }
+            }
+            
+            char const *pivot = *middle;
+            char **low = first - 1;
+            char **high = last + 1;
+            while (true) {
+                do ++low; while (compare_strings(order, *low, pivot) < 0);
+                do --high; while (compare_strings(order, pivot, *high) < 0);
+                if (low >= high) break;
+                swap_strings(low, high);
+            }
+            
+            size_t low_count = (size_t)(high - strings) + 1;
+            size_t high_count = count - low_count;
+            if (low_count < high_count) {
+                stack[stack_count].strings = high + 1;
+                stack[stack_count].count = high_count;
+                count = low_count;
+            } else {
+                stack[stack_count].strings = strings;
+                stack[stack_count].count = low_count;
+                strings = high + 1;
+                count = high_count;
+            }
+            ++stack_count;
+        }
+        
+        for (size_t i = 1; i < count; ++i) {
+            char *string = strings[i];
+            size_t j = i;
+            while (   j > 0
+                   && compare_strings(order, string, strings[j - 1]) < 0)
+            {
+                strings[j] = strings[j - 1];
+                --j;
+            }
+            strings[j] = string;
+        }
+        
+        if (!stack_count) return;
+        --stack_count;
+        strings = stack[stack_count].strings;
+        count = stack[stack_count].count;
+    }
+}
+
+
+static void
+sort_strings(enum stringset_order order, char **strings, size_t count)
+{
+    switch (order) {
+        case stringset_order_length_first:
+            sort_in_order(stringset_order_length_first, strings, count);
+            break;
+        case stringset_order_case_folded:
+            sort_in_order(stringset_order_case_folded, strings, count);
+            break;
+        default:
+            sort_in_order(stringset_order_lexical, strings, count);
+            break;
+    }
+}
+
+
+// Find the end of the natural run of strings that starts at `start': either
+// ascending, or strictly descending, in which case the run is reversed.
+static size_t
+find_run(enum stringset_order order,
+         char **strings,
+         size_t start,
+         size_t count)
+{
+    size_t end = start + 1;
+    if (end == count) return end;
+    
+    if (compare_strings(order, strings[end], strings[start]) < 0) {
+        do ++end; while (   end < count
+                         && compare_strings(order,
+                                            strings[end],
+                                            strings[end - 1]) < 0);
+        for (size_t i = start, j = end - 1; i < j; ++i, --j) {
+            swap_strings(&strings[i], &strings[j]);
+        }
+    } else {
+        do ++end; while (   end < count
+                         && compare_strings(order,
+                                            strings[end],
+                                            strings[end - 1]) >= 0);
+    }
+    return end;
+}
+
+
+// Merge the sorted runs `from[start..middle)' and `from[middle..end)' into
+// `to[start..end)'.
+static void
+merge_runs(enum stringset_order order,
+           char *const *from,
+           size_t start,
+           size_t middle,
+           size_t end,
+           char **to)
+{
+    size_t i = start;
+    size_t j = middle;
+    size_t k = start;
+    while (i < middle && j < end) {
+        if (compare_strings(order, from[j], from[i]) < 0) {
+            to[k++] = from[j++];
+        } else {
+            to[k++] = from[i++];
+        }
+    }
+    memcpy(to + k, from + i, sizeof(char *) * (middle - i));
+    k += middle - i;
+    memcpy(to + k, from + j, sizeof(char *) * (end - j));
+}
+
+
+// Sort strings that may already be sorted or nearly sorted, like timsort:
+// the natural runs are found in one pass and merged pairwise.  Sorted input
+// costs `count - 1' comparisons and no memory.  Input whose runs are too
+// short to be worth merging is sorted by `sort_strings()' instead.
+static int
+sort_runs(struct stringset const *stringset, char **strings, size_t count)
+{
+    enum stringset_order order = stringset->order;
+    if (count < 2) return 0;
+    size_t end = find_run(order, strings, 0, count);
+    if (end == count) return 0;
+    
+    COUNT(stringset->stats, sorts, 1);
+    size_t max_runs_count = count / MIN_AVERAGE_RUN_COUNT + 1;
+    size_t starts_size = sizeof(size_t) * (max_runs_count + 1);
+    size_t *starts = alloc_memory(stringset, starts_size);
+    if (!starts) return -1;
+    
+    size_t runs_count = 0;
+    starts[runs_count++] = 0;
+    while (end < count && runs_count < max_runs_count) {
+        starts[runs_count++] = end;
+        end = find_run(order, strings, end, count);
+    }
+    if (end < count) {
+        free_memory(stringset, starts, starts_size);
+        sort_strings(order, strings, count);
+        return 0;
+    }
+    starts[runs_count] = count;
+    
+    char **scratch = alloc_memory(stringset, sizeof(char *) * count);
+    if (!scratch) {
+        free_memory(stringset, starts, starts_size);
+        return -1;
+    }
+    char **from = strings;
+    char **to = scratch;
+    while (runs_count > 1) {
+        size_t merged_count = 0;
+        for (size_t i = 0; i < runs_count; i += 2) {
+            size_t middle = starts[i + 1];
+            size_t run_end = i + 2 <= runs_count ? starts[i + 2] : middle;
+            merge_runs(order, from, starts[i], middle, run_end, to);
+            starts[merged_count++] = starts[i];
+        }
+        starts[merged_count] = count;
+        runs_count = merged_count;
+        
+        char **merged = to;
+        to = from;
+        from = merged;
+    }
+    if (from != strings) memcpy(strings, from, sizeof(char *) * count);
+    
+    free_memory(stringset, scratch, sizeof(char *) * count);
+    free_memory(stringset, starts, starts_size);
+    return 0;
+}
+
+
+// Remove adjacent duplicates from sorted strings and return the new count.
+static size_t
+remove_duplicates(enum stringset_order order,
+                  char const **strings,
+                  size_t count)
+{
+    size_t unique_count = count ? 1 : 0;
+    for (size_t i = 1; i < count; ++i) {
+        if (compare_strings(order, strings[unique_count - 1], strings[i])) {
+            strings[unique_count++] = strings[i];
+        }
+    }
+    return unique_count;
+}
+
+
+// Check that strings are sorted in `order' with no duplicates or NULLs.
+static bool
+is_sorted_array(enum stringset_order order,
+                char const *const *strings,
+                size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (!strings[i]) return false;
+        if (i && compare_strings(order, strings[i - 1], strings[i]) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Allocate a sorted copy of an array of string pointers.  The strings aren't
+// copied.  Sets `errno' to `EINVAL' if the array contains NULL.
+static char const **
+alloc_sorted_array(struct stringset const *stringset,
+                   char const *const *array,
+                   size_t count)
+{
+    if (count > MAX_COUNT) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!array[i]) {
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+    
+    char const **sorted = alloc_memory(stringset, sizeof(char *) * (count + 1));
+    if (!sorted) return NULL;
+    
+    memcpy(sorted, array, sizeof(char *) * count);
+    if (-1 == sort_runs(stringset, (char **)sorted, count)) {
+        free_memory(stringset, sorted, sizeof(char *) * (count + 1));
+        return NULL;
+    }
+    return sorted;
+}
+
+
+// Count the members common to two flushed string sets in one merge pass over
+// their sorted members.
+static size_t
+count_common(struct stringset const *first, struct stringset const *second)
+{
+    size_t common_count = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < first->count && j < second->count) {
+        int order = compare_strings(first->order,
+                                    first->members[i],
+                                    second->members[j]);
+        if (order < 0) {
+            ++i;
+        } else if (order > 0) {
+            ++j;
+        } else {
+            ++common_count;
+            ++i;
+            ++j;
+        }
+    }
+    return common_count;
+}
+
+
+// Binary search for a string in sorted members.  Like `sort_in_order()',
+// this is inlined into `find()' once for each order.
+static inline __attribute__((always_inline)) char **
+search_in_order(enum stringset_order order,
+                char **members,
+                size_t count,
+                char const *string)
+{
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int result = compare_strings(order, members[middle], string);
+        if (result < 0) {
+            low = middle + 1;
+        } else if (result > 0) {
+            high = middle;
+        } else {
+            return &members[middle];
+        }
+    }
+    return NULL;
+}
+
+
+static char **
+find(struct stringset const *stringset, char const *string)
+{
+    size_t sorted_count = stringset->count - stringset->pending_count;
+    if (!sorted_count) return NULL;
+    
+    COUNT(stringset->stats, searches, 1);
+    char **members = stringset->members;
+    switch (stringset->order) {
+        case stringset_order_length_first:
+            return search_in_order(stringset_order_length_first,
+                                   members,
+                                   sorted_count,
+                                   string);
+        case stringset_order_case_folded:
+            return search_in_order(stringset_order_case_folded,
+                                   members,
+                                   sorted_count,
+                                   string);
+        default:
+            return search_in_order(stringset_order_lexical,
+                                   members,
+                                   sorted_count,
+                                   string);
+    }
+}
+
+
+// Find the index of the first of `count' sorted members at or after `start'
+// that is not less than `string'.  The search probes exponentially growing
+// steps from `start' before a binary search, so it is fast when the result is
+// near `start'.
+static size_t
+gallop(enum stringset_order order,
+       char **members,
+       size_t count,
+       size_t start,
+       char const *string)
+{
+    size_t low = start;
+    size_t step = 1;
+    size_t high = start;
+    while (   high < count
+           && compare_strings(order, members[high], string) < 0)
+    {
+        low = high + 1;
+        high = start + step;
+        step *= 2;
+    }
+    if (high > count) high = count;
+    
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (compare_strings(order, members[middle], string) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+
+// The first bytes of a string as an integer that orders like the string in a
+// string set order.  Strings with equal prefixes must be compared in full.
+// The length-first prefix is the length followed by the first four bytes.
+static uint64_t
+string_prefix(enum stringset_order order, char const *string)
+{
+    unsigned char const *s = (unsigned char const *)string;
+    uint64_t prefix = 0;
+    int byte_count = 8;
+    if (stringset_order_length_first == order) {
+        size_t length = strlen(string);
+        prefix = length < UINT32_MAX ? length : UINT32_MAX;
+        byte_count = 4;
+    }
+    
+    bool is_case_folded = stringset_order_case_folded == order;
+    for (int i = 0; i < byte_count; ++i) {
+        unsigned char c = *s;
+        if (c) ++s;
+        prefix = prefix << 8 | (is_case_folded ? fold_case(c) : c);
+    }
+    return prefix;
+}
+
+
+// The hash of a member of a string set used by filters and sketches.
+static uint64_t
+hash_member(struct stringset const *stringset, char const *string)
+{
+    return mix_hash(hash_string(stringset->order, string));
+}
+
+
+// The interned string whose bytes are `string'.
+static struct pool_string *
+pool_string(char const *string)
+{
+    return (struct pool_string *)(string - offsetof(struct pool_string, bytes));
+}
+
+
+// Double the hash table of an interning pool.
+static int
+grow_pool(struct stringset_pool *pool)
+{
+    size_t new_capacity = pool->capacity ? 2 * pool->capacity
+                                         : MIN_POOL_CAPACITY;
+    struct pool_string **new_slots = calloc(new_capacity,
+                                            sizeof(struct pool_string *));
+    if (!new_slots) return -1;
+    
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < pool->capacity; ++i) {
+        struct pool_string *interned = pool->slots[i];
+        if (!interned) continue;
+        
+        size_t j = interned->hash & mask;
+        while (new_slots[j]) j = (j + 1) & mask;
+        new_slots[j] = interned;
+    }
+    
+    free(pool->slots);
+    pool->slots = new_slots;
+    pool->capacity = new_capacity;
+    return 0;
+}
+
+
+// Return the interned copy of a string with a new reference, interning it
+// first if it isn't in the pool.
+static char *
+pool_intern(struct stringset_pool *pool, char const *string)
+{
+    if (2 * (pool->count + 1) > pool->capacity) {
+        if (-1 == grow_pool(pool)) return NULL;
+    }
+    
+    uint64_t hash = mix_hash(hash_string(stringset_order_lexical, string));
+    size_t mask = pool->capacity - 1;
+    size_t i = hash & mask;
+    for (; pool->slots[i]; i = (i + 1) & mask) {
+        struct pool_string *interned = pool->slots[i];
+        if (interned->hash == hash && 0 == strcmp(interned->bytes, string)) {
+            ++interned->reference_count;
+            return interned->bytes;
+        }
+    }
+    
+    size_t size = strlen(string) + 1;
+    struct pool_string *interned = malloc(sizeof(struct pool_string) + size);
+    if (!interned) return NULL;
+    
+    interned->hash = hash;
+    interned->reference_count = 1;
+    memcpy(interned->bytes, string, size);
+    pool->slots[i] = interned;
+    ++pool->count;
+    return interned->bytes;
+}
+
+
+// Drop a reference to an interned string.  The last reference removes it
+// from the pool, shifting back the strings probed after it so that no
+// tombstones are needed.
+static void
+pool_release(struct stringset_pool *pool, char *string)
+{
+    struct pool_string *interned = pool_string(string);
+    if (--interned->reference_count) return;
+    
+    size_t mask = pool->capacity - 1;
+    size_t i = interned->hash & mask;
+    while (pool->slots[i] != interned) i = (i + 1) & mask;
+    for (size_t j = (i + 1) & mask; pool->slots[j]; j = (j + 1) & mask) {
+        size_t home = pool->slots[j]->hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            pool->slots[i] = pool->slots[j];
+            i = j;
+        }
+    }
+    pool->slots[i] = NULL;
+    --pool->count;
+    free(interned);
+}
+
+
+static bool
+is_short_string(char const *string)
+{
+    return strnlen(string, SHORT_STRING_SIZE) < SHORT_STRING_SIZE;
+}
+
+
+// The short string whose bytes are `string'.
+static struct short_string *
+short_string(char const *string)
+{
+    return (struct short_string *)(  string
+                                   - offsetof(struct short_string, bytes));
+}
+
+
+static struct stringset_slab *
+slab_of(struct short_string *slot)
+{
+    return (struct stringset_slab *)(  (char *)(slot - slot->index)
+                                     - offsetof(struct stringset_slab, slots));
+}
+
+
+// Drop a use of a slab, freeing it when it has none left.
+static void
+release_slab(struct stringset_slab *slab)
+{
+    if (slab && !__atomic_sub_fetch(&slab->live_count, 1, __ATOMIC_ACQ_REL)) {
+        struct stringset_allocator allocator = slab->allocator;
+        deallocate(&allocator, slab);
+    }
+}
+
+
+// Take a free slot from the current slab of a string set, moving on to a new
+// slab once the current one is full.
+static struct short_string *
+alloc_slot(struct stringset *stringset)
+{
+    struct stringset_slab *slab = stringset->slab;
+    struct short_string *slot = NULL;
+    if (slab) slot = __atomic_load_n(&slab->free_slots, __ATOMIC_ACQUIRE);
+    while (slot) {
+        struct short_string *next;
+        memcpy(&next, slot->bytes, sizeof next);
+        if (__atomic_compare_exchange_n(&slab->free_slots,
+                                        &slot,
+                                        next,
+                                        true,
+                                        __ATOMIC_ACQUIRE,
+                                        __ATOMIC_ACQUIRE))
+        {
+            __atomic_add_fetch(&slab->live_count, 1, __ATOMIC_RELAXED);
+            return slot;
+        }
+    }
+    
+    if (!slab || slab->used_count == slab->capacity) {
+        int capacity = MIN_SLAB_SLOTS;
+        if (slab) {
+            capacity = slab->capacity < MAX_SLAB_SLOTS / 2 ? 2 * slab->capacity
+                                                           : MAX_SLAB_SLOTS;
+        }
+        struct stringset_slab *new_slab = allocate(
+            &stringset->allocator,
+            sizeof(struct stringset_slab)
+            + sizeof(struct short_string) * capacity);
+        if (!new_slab) return NULL;
+        
+        new_slab->allocator = stringset->allocator;
+        new_slab->live_count = 1;
+        new_slab->free_slots = NULL;
+        new_slab->capacity = capacity;
+        new_slab->used_count = 0;
+        release_slab(slab);
+        stringset->slab = slab = new_slab;
+    }
+    
+    slot = &slab->slots[slab->used_count];
+    slot->index = (uint32_t)slab->used_count;
+    ++slab->used_count;
+    __atomic_add_fetch(&slab->live_count, 1, __ATOMIC_RELAXED);
+    return slot;
+}
+
+
+// Return a slot to its slab.
+static void
+free_slot(struct short_string *slot)
+{
+    struct stringset_slab *slab = slab_of(slot);
+    struct short_string *next = __atomic_load_n(&slab->free_slots,
+                                                __ATOMIC_RELAXED);
+    do {
+        memcpy(slot->bytes, &next, sizeof next);
+    } while (!__atomic_compare_exchange_n(&slab->free_slots,
+                                          &next,
+                                          slot,
+                                          true,
+                                          __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+    release_slab(slab);
+}
+
+
+// The member string whose bytes are `string'.
+static struct member_string *
+member_string(char const *string)
+{
+    return (struct member_string *)(  string
+                                    - offsetof(struct member_string, bytes));
+}
+
+
+// Add a reference to a member of a string set.
+static void
+retain_string(struct stringset const *stringset, char *string)
+{
+    if (stringset->pool) {
+        ++pool_string(string)->reference_count;
+    } else if (is_short_string(string)) {
+        __atomic_add_fetch(&short_string(string)->reference_count,
+                           1,
+                           __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&member_string(string)->reference_count,
+                           1,
+                           __ATOMIC_RELAXED);
+    }
+}
+
+
+// Copy a string for a new member of a string set.  Members of a set with an
+// interning pool are interned; if `source' is not NULL, `string' is a member
+// of `source', and a member of a set with the same pool is shared as is.
+static char *
+copy_string(struct stringset *stringset,
+            struct stringset const *source,
+            char const *string)
+{
+    struct stringset_pool *pool = stringset->pool;
+    if (pool) {
+        if (source && source->pool == pool) {
+            ++pool_string(string)->reference_count;
+            return (char *)string;
+        }
+        return pool_intern(pool, string);
+    }
+    
+    size_t size = strlen(string) + 1;
+    if (size <= SHORT_STRING_SIZE) {
+        struct short_string *slot = alloc_slot(stringset);
+        if (!slot) return NULL;
+        
+        COUNT(stringset->stats, bytes_allocated, sizeof(struct short_string));
+        slot->reference_count = 1;
+        memcpy(slot->bytes, string, size);
+        return slot->bytes;
+    }
+    
+    struct member_string *copy = alloc_memory(stringset,
+                                              sizeof(struct member_string)
+                                              + size);
+    if (!copy) return NULL;
+    
+    copy->reference_count = 1;
+    memcpy(copy->bytes, string, size);
+    return copy->bytes;
+}
+
+
+// Drop a reference to a member of a string set, freeing it when no string
+// set refers to it any more.
+static void
+free_string(struct stringset const *stringset, char *string)
+{
+    if (stringset->pool) {
+        pool_release(stringset->pool, string);
+        return;
+    }
+    if (is_short_string(string)) {
+        struct short_string *slot = short_string(string);
+        if (__atomic_sub_fetch(&slot->reference_count, 1, __ATOMIC_ACQ_REL)) {
+            return;
+        }
+        COUNT(stringset->stats, bytes_freed, sizeof(struct short_string));
+        free_slot(slot);
+        return;
+    }
+    
+    struct member_string *member = member_string(string);
+    if (__atomic_sub_fetch(&member->reference_count, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+#ifdef STRINGSET_STATS
+    COUNT(stringset->stats,
+          bytes_freed,
+          sizeof(struct member_string) + strlen(string) + 1);
+#endif
+    free_memory(stringset, member, 0);
+}
+
+
+// Fill a search index in Eytzinger order by an in-order walk of its implicit
+// tree, returning the index of the next sorted member.
+static size_t
+fill_index(struct stringset const *stringset,
+           struct stringset_index *index,
+           size_t entry,
+           size_t member)
+{
+    if (entry > index->count) return member;
+    
+    member = fill_index(stringset, index, 2 * entry, member);
+    char *string = stringset->members[member];
+    index->prefixes[entry] = string_prefix(stringset->order, string);
+    index->members[entry] = string;
+    return fill_index(stringset, index, 2 * entry + 1, member + 1);
+}
+
+
+// Search the index of a string set.  Each step prefetches the cache line of
+// prefixes that the search reaches three steps later.
+static bool
+index_contains(struct stringset const *stringset, char const *string)
+{
+    COUNT(stringset->stats, searches, 1);
+    struct stringset_index const *index = stringset->index;
+    uint64_t prefix = string_prefix(stringset->order, string);
+    size_t entry = 1;
+    while (entry <= index->count) {
+        __builtin_prefetch(index->prefixes + INDEX_LINE_PREFIXES * entry);
+        uint64_t entry_prefix = index->prefixes[entry];
+        int order;
+        if (prefix != entry_prefix) {
+            order = prefix < entry_prefix ? -1 : 1;
+        } else {
+            order = compare_strings(stringset->order,
+                                    string,
+                                    index->members[entry]);
+            if (!order) return true;
+        }
+        entry = 2 * entry + (order > 0);
+    }
+    return false;
+}
+
+
+// Let go of the members array a string set shares with clones, which may be
+// letting go of it on other threads at the same time.  Whichever string set
+// drops the share count to zero frees the array and its references to the
+// members.
+static void
+release_shared_members(struct stringset *stringset)
+{
+    size_t *share_count = stringset->share_count;
+    stringset->share_count = NULL;
+    if (__atomic_sub_fetch(share_count, 1, __ATOMIC_ACQ_REL)) return;
+    
+    if (frees_members(stringset)) {
+        for (size_t i = 0; i < stringset->count; ++i) {
+            free_string(stringset, stringset->members[i]);
+        }
+    }
+    free_members(stringset, stringset->members, stringset->capacity);
+    free_memory(stringset, share_count, sizeof(size_t));
+}
+
+
+// Give a string set its own members array before it is modified, if it
+// shares the array with clones.  Only the array of pointers is copied; the
+// member strings stay shared and get another reference.
+static int
+unshare_members(struct stringset *stringset)
+{
+    if (!stringset->share_count) return 0;
+    
+    if (is_shared(stringset)) {
+        size_t capacity = stringset->capacity;
+        char **members = alloc_members(stringset, &capacity);
+        if (!members) return -1;
+        
+        memcpy(members, stringset->members, sizeof(char *) * stringset->count);
+        if (frees_members(stringset)) {
+            for (size_t i = 0; i < stringset->count; ++i) {
+                retain_string(stringset, members[i]);
+            }
+        }
+        release_shared_members(stringset);
+        stringset->members = members;
+        stringset->capacity = capacity;
+    } else {
+        free_memory(stringset, stringset->share_count, sizeof(size_t));
+    }
+    stringset->share_count = NULL;
+    return 0;
+}
+
+
+// Prepare the members array of a string set to be modified: drop its search
+// index, which isn't updated in place, and unshare the array from clones.
+static int
+modify_members(struct stringset *stringset)
+{
+    drop_index(stringset);
+    return unshare_members(stringset);
+}
+
+
+// The high half of a filter hash selects a block and the low half and the
+// high half generate bit positions within it by double hashing.
+static uint64_t *
+filter_block(struct stringset_filter const *filter, uint64_t hash)
+{
+    size_t index = ((hash >> 32) * filter->block_count) >> 32;
+    return filter->blocks + FILTER_BLOCK_WORDS * index;
+}
+
+
+static void
+filter_add(struct stringset_filter *filter, uint64_t hash)
+{
+    uint64_t *block = filter_block(filter, hash);
+    uint32_t bit = (uint32_t)hash;
+    uint32_t step = (uint32_t)(hash >> 32) | 1;
+    for (int i = 0; i < filter->hash_count; ++i) {
+        unsigned index = bit % (64 * FILTER_BLOCK_WORDS);
+        block[index / 64] |= UINT64_C(1) << (index % 64);
+        bit += step;
+    }
+}
+
+
+static bool
+filter_may_contain(struct stringset_filter const *filter, uint64_t hash)
+{
+    uint64_t const *block = filter_block(filter, hash);
+    uint32_t bit = (uint32_t)hash;
+    uint32_t step = (uint32_t)(hash >> 32) | 1;
+    for (int i = 0; i < filter->hash_count; ++i) {
+        unsigned index = bit % (64 * FILTER_BLOCK_WORDS);
+        if (!(block[index / 64] & (UINT64_C(1) << (index % 64)))) return false;
+        bit += step;
+    }
+    return true;
+}
+
+
+// Merge sketch registers by taking the larger value of each register.
+static void
+merge_registers(uint8_t *registers,
+                uint8_t const *other,
+                size_t register_count)
+{
+    for (size_t i = 0; i < register_count; ++i) {
+        if (other[i] > registers[i]) registers[i] = other[i];
+    }
+}
+
+
+static void
+sketch_add(struct stringset_sketch *sketch, uint64_t hash)
+{
+    size_t index = hash >> (64 - sketch->precision);
+    uint64_t rest = hash << sketch->precision;
+    int max_rank = 64 - sketch->precision + 1;
+    int rank = rest ? __builtin_clzll(rest) + 1 : max_rank;
+    if (rank > max_rank) rank = max_rank;
+    if (rank > sketch->registers[index]) sketch->registers[index] = rank;
+}
+
+
+// Estimate a cardinality from HyperLogLog registers, using linear counting
+// for small cardinalities where the raw estimate is biased.  With 64-bit
+// hashes no large range correction is needed.
+static double
+sketch_estimate(uint8_t const *registers, int precision)
+{
+    size_t register_count = (size_t)1 << precision;
+    double m = (double)register_count;
+    double alpha;
+    switch (register_count) {
+        case 16: alpha = 0.673; break;
+        case 32: alpha = 0.697; break;
+        case 64: alpha = 0.709; break;
+        default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+    }
+    
+    double sum = 0.0;
+    size_t zeros_count = 0;
+    for (size_t i = 0; i < register_count; ++i) {
+        sum += ldexp(1.0, -registers[i]);
+        if (!registers[i]) ++zeros_count;
+    }
+    
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros_count) {
+        estimate = m * log(m / zeros_count);
+    }
+    return estimate;
+}
+
+
+// Check that an array of sketches is not empty and all of its sketches have
+// the same precision.
+static bool
+sketches_are_compatible(struct stringset_sketch const *const *sketches,
+                        int count)
+{
+    if (!sketches || count < 1) return false;
+    for (int i = 0; i < count; ++i) {
+        if (!sketches[i]) return false;
+        if (sketches[i]->precision != sketches[0]->precision) return false;
+    }
+    return true;
+}
+
+
+// Estimate the union of the sketches selected by the bits of `subset'.
+// `registers' is scratch space for the merged registers.
+static double
+sketch_estimate_subset(struct stringset_sketch const *const *sketches,
+                       int count,
+                       unsigned subset,
+                       uint8_t *registers)
+{
+    int precision = sketches[0]->precision;
+    size_t register_count = (size_t)1 << precision;
+    memset(registers, 0, register_count);
+    for (int i = 0; i < count; ++i) {
+        if (subset & (1u << i)) {
+            merge_registers(registers, sketches[i]->registers, register_count);
+        }
+    }
+    return sketch_estimate(registers, precision);
+}
+
+
+// Walk the members of a flushed string set together with a sorted array of
+// strings, keeping the members that are present in the array if
+// `keep_common' is true or absent from it otherwise.  Dropped members are
+// freed and kept members are moved down in place, so nothing is allocated.
+static void
+keep_members(struct stringset *stringset,
+             char const *const *sorted,
+             size_t sorted_count,
+             bool keep_common)
+{
+    size_t new_count = 0;
+    size_t j = 0;
+    for (size_t i = 0; i < stringset->count; ++i) {
+        char *member = stringset->members[i];
+        while (   j < sorted_count
+               && compare_strings(stringset->order, sorted[j], member) < 0)
+        {
+            ++j;
+        }
+        bool is_common = (   j < sorted_count
+                          && 0 == compare_strings(stringset->order,
+                                                  sorted[j],
+                                                  member));
+        if (is_common == keep_common) {
+            stringset->members[new_count++] = member;
+        } else {
+            free_string(stringset, member);
+        }
+    }
+    
+    if (new_count < stringset->count) {
+        stringset->count = new_count;
+        if (stringset->filter) stringset->filter->is_stale = true;
+    }
+}
+
+
+static void
+merge_pending(struct stringset *stringset)
+{
+    size_t sorted_count = stringset->count - stringset->pending_count;
+    char **pending = stringset->members + sorted_count;
+    COUNT(stringset->stats, sorts, 1);
+    sort_strings(stringset->order, pending, stringset->pending_count);
+    
+    // The pending index has at least twice as many slots as there are pending
+    // members, so it holds the sorted pending members while they are merged
+    // backwards into the members array.
+    char **sorted_pending = stringset->pending;
+    memcpy(sorted_pending, pending, sizeof(char *) * stringset->pending_count);
+    
+    size_t i = sorted_count;
+    size_t j = stringset->pending_count;
+    size_t k = stringset->count;
+    while (j) {
+        if (   i
+            && compare_strings(stringset->order,
+                               stringset->members[i - 1],
+                               sorted_pending[j - 1]) > 0)
+        {
+            stringset->members[--k] = stringset->members[--i];
+        } else {
+            stringset->members[--k] = sorted_pending[--j];
+        }
+    }
+    
+    size_t pending_size = sizeof(char *) * stringset->pending_capacity;
+    memset(stringset->pending, 0, pending_size);
+    stringset->pending_count = 0;
+}
+
+
+// Merge pending members.  This doesn't change which strings are members, so
+// it's called on `const' string sets before their members are read.
+static void
+flush(struct stringset const *stringset)
+{
+    if (stringset->pending_count) {
+        merge_pending((struct stringset *)stringset);
+    }
+}
+
+
+static bool
+pending_contains(struct stringset const *stringset, char const *string)
+{
+    if (!stringset->pending_count) return false;
+    
+    COUNT(stringset->stats, searches, 1);
+    size_t mask = stringset->pending_capacity - 1;
+    size_t i = hash_string(stringset->order, string) & mask;
+    for ( ; stringset->pending[i]; i = (i + 1) & mask) {
+        char const *member = stringset->pending[i];
+        if (0 == compare_strings(stringset->order, member, string)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static void
+pending_insert(enum stringset_order order,
+               char **pending,
+               size_t pending_capacity,
+               char *string)
+{
+    size_t mask = pending_capacity - 1;
+    size_t i = hash_string(order, string) & mask;
+    while (pending[i]) i = (i + 1) & mask;
+    pending[i] = string;
+}
+
+
+// Build a filter sized for `capacity' members with the given false positive
+// rate and replace the string set's filter with it.
+static int
+rebuild_filter(struct stringset *stringset,
+               size_t capacity,
+               double false_positive_rate)
+{
+    if (capacity < MIN_FILTER_CAPACITY) capacity = MIN_FILTER_CAPACITY;
+    double ln_2 = log(2.0);
+    double bits_per_member = -log(false_positive_rate) / (ln_2 * ln_2);
+    double bit_count = ceil(bits_per_member * (double)capacity);
+    size_t block_bits = 64 * FILTER_BLOCK_WORDS;
+    size_t block_count = (size_t)ceil(bit_count / block_bits);
+    int hash_count = (int)lround(bits_per_member * ln_2);
+    if (hash_count < 1) hash_count = 1;
+    if (hash_count > 16) hash_count = 16;
+    
+    struct stringset_filter *filter;
+    filter = alloc_memory(stringset, sizeof(struct stringset_filter));
+    if (!filter) return -1;
+    
+    size_t blocks_size = sizeof(uint64_t) * FILTER_BLOCK_WORDS * block_count;
+    filter->blocks = alloc_memory(stringset, blocks_size);
+    if (!filter->blocks) {
+        free_memory(stringset, filter, sizeof(struct stringset_filter));
+        return -1;
+    }
+    memset(filter->blocks, 0, blocks_size);
+    filter->block_count = block_count;
+    filter->hash_count = hash_count;
+    filter->capacity = capacity;
+    filter->is_stale = false;
+    filter->false_positive_rate = false_positive_rate;
+    
+    for (size_t i = 0; i < stringset->count; ++i) {
+        filter_add(filter, hash_member(stringset, stringset->members[i]));
+    }
+    
+    drop_filter(stringset);
+    stringset->filter = filter;
+    return 0;
+}
+
+
+static int
+read_varint(unsigned char const **cursor,
+            unsigned char const *end,
+            size_t *value)
+{
+    *value = 0;
+    for (int shift = 0; *cursor < end && shift < 64; shift += 7) {
+        unsigned char byte = **cursor;
+        ++*cursor;
+        *value |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return 0;
+    }
+    
+    errno = EINVAL;
+    return -1;
+}
+
+
+static int
+remove_array(struct stringset *stringset,
+             char const *const *array,
+             size_t count)
+{
+    char const **sorted = alloc_sorted_array(stringset, array, count);
+    if (!sorted) return -1;
+    
+    flush(stringset);
+    if (-1 == modify_members(stringset)) {
+        free_memory(stringset, sorted, sizeof(char *) * (count + 1));
+        return -1;
+    }
+    keep_members(stringset, sorted, count, false);
+    free_memory(stringset, sorted, sizeof(char *) * (count + 1));
+    
+    int result = stringset_compact(stringset);
+    if (-1 == result) return -1;
+    
+    return 0;
+}
+
+
+static int
+reserve(struct stringset *stringset, size_t count)
+{
+    if (count <= stringset->capacity) return 0;
+    if (count > MAX_COUNT) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    
+    size_t new_capacity = stringset->capacity ? 2 * stringset->capacity : 4;
+    while (new_capacity < count) new_capacity *= 2;
+    if (new_capacity > MAX_COUNT) new_capacity = MAX_COUNT;
+    return resize_members(stringset, new_capacity);
+}
+
+
+// Grow the pending index so that it is at most half full with
+// `pending_count' members.
+static int
+reserve_pending(struct stringset *stringset, size_t pending_count)
+{
+    if (2 * pending_count <= stringset->pending_capacity) return 0;
+    
+    size_t new_capacity = stringset->pending_capacity
+                     ? 2 * stringset->pending_capacity
+                     : 2 * MIN_PENDING_COUNT;
+    while (new_capacity < 2 * pending_count) new_capacity *= 2;
+    size_t new_size = sizeof(char *) * new_capacity;
+    char **new_pending = alloc_memory(stringset, new_size);
+    if (!new_pending) return -1;
+    memset(new_pending, 0, new_size);
+    
+    size_t first_pending = stringset->count - stringset->pending_count;
+    for (size_t i = first_pending; i < stringset->count; ++i) {
+        pending_insert(stringset->order,
+                       new_pending,
+                       new_capacity,
+                       stringset->members[i]);
+    }
+    size_t size = sizeof(char *) * stringset->pending_capacity;
+    free_memory(stringset, stringset->pending, size);
+    stringset->pending = new_pending;
+    stringset->pending_capacity = new_capacity;
+    return 0;
+}
+
+
+// Append a copy of a string that sorts after every member of a string set.
+// `source' is the string set that `string' is a member of, or NULL.
+static int
+append(struct stringset *stringset,
+       struct stringset const *source,
+       char const *string)
+{
+    if (-1 == reserve(stringset, stringset->count + 1)) return -1;
+    
+    char *member = copy_string(stringset, source, string);
+    if (!member) return -1;
+    
+    stringset->members[stringset->count] = member;
+    ++stringset->count;
+    return 0;
+}
+
+
+static int
+compare_cursors(enum stringset_order order,
+                struct cursor const *first,
+                struct cursor const *second)
+{
+    return compare_strings(order,
+                           first->members[first->index],
+                           second->members[second->index]);
+}
+
+
+// Restore the order of a min-heap of cursors after the cursor at `index'
+// moved forward.
+static void
+sift_cursor(enum stringset_order order,
+            struct cursor *heap,
+            int heap_count,
+            int index)
+{
+    while (true) {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        if (   left < heap_count
+            && compare_cursors(order, &heap[left], &heap[smallest]) < 0)
+        {
+            smallest = left;
+        }
+        if (   right < heap_count
+            && compare_cursors(order, &heap[right], &heap[smallest]) < 0)
+        {
+            smallest = right;
+        }
+        if (smallest == index) return;
+        
+        struct cursor cursor = heap[index];
+        heap[index] = heap[smallest];
+        heap[smallest] = cursor;
+        index = smallest;
+    }
+}
+
+
+// Allocate a string set of the strings that are members of at least
+// `min_count' of the given string sets with a k-way merge.  The members
+// array is allocated once at its largest possible size and then compacted.
+static struct stringset *
+alloc_merged(struct stringset const *const *stringsets,
+             int count,
+             int min_count)
+{
+    struct stringset *stringset = alloc_like(stringsets[0]);
+    if (!stringset) return NULL;
+    
+    struct cursor *heap = alloc_memory(stringset,
+                                       sizeof(struct cursor) * count);
+    if (!heap) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    size_t total_count = 0;
+    int heap_count = 0;
+    for (int i = 0; i < count; ++i) {
+        flush(stringsets[i]);
+        if (!stringsets[i]->count) continue;
+        
+        heap[heap_count].stringset = stringsets[i];
+        heap[heap_count].members = stringsets[i]->members;
+        heap[heap_count].count = stringsets[i]->count;
+        heap[heap_count].index = 0;
+        ++heap_count;
+        if (total_count < MAX_COUNT) total_count += stringsets[i]->count;
+    }
+    enum stringset_order order = stringset->order;
+    for (int i = heap_count / 2 - 1; i >= 0; --i) {
+        sift_cursor(order, heap, heap_count, i);
+    }
+    
+    size_t max_count = total_count / (size_t)min_count;
+    if (max_count > MAX_COUNT) max_count = MAX_COUNT;
+    int result = reserve(stringset, max_count);
+    
+    while (-1 != result && heap_count) {
+        struct stringset const *source = heap[0].stringset;
+        char const *string = heap[0].members[heap[0].index];
+        int occurrences = 0;
+        while (   heap_count
+               && 0 == compare_strings(order,
+                                       heap[0].members[heap[0].index],
+                                       string))
+        {
+            ++occurrences;
+            if (++heap[0].index == heap[0].count) {
+                heap[0] = heap[--heap_count];
+            }
+            sift_cursor(order, heap, heap_count, 0);
+        }
+        if (occurrences >= min_count) {
+            result = append(stringset, source, string);
+        }
+    }
+    
+    free_memory(stringset, heap, sizeof(struct cursor) * count);
+    if (-1 == result || -1 == stringset_compact(stringset)) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    return stringset;
+}
+
+
+// Check that an array of string sets is not empty and its string sets can be
+// combined.
+static bool
+is_valid_array(struct stringset const *const *stringsets, int count)
+{
+    if (!stringsets || count < 1 || !stringsets[0]) return false;
+    for (int i = 1; i < count; ++i) {
+        if (!are_compatible(stringsets[0], stringsets[i])) return false;
+    }
+    return true;
+}
+
+
+// Read members written by `buffer_append_members()' into an empty string set.
+static int
+read_members(unsigned char const **cursor,
+             unsigned char const *end,
+             struct stringset *stringset)
+{
+    size_t count;
+    if (-1 == read_varint(cursor, end, &count)) return -1;
+    if (count > MAX_COUNT || count > (size_t)(end - *cursor) / 2) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (-1 == reserve(stringset, count)) return -1;
+    
+    struct buffer member = { NULL, 0, 0 };
+    for (size_t i = 0; i < count; ++i) {
+        size_t prefix_length;
+        size_t suffix_length;
+        if (   -1 == read_varint(cursor, end, &prefix_length)
+            || -1 == read_varint(cursor, end, &suffix_length)
+            || prefix_length > member.size
+            || suffix_length > (size_t)(end - *cursor))
+        {
+            free(member.bytes);
+            errno = EINVAL;
+            return -1;
+        }
+        
+        member.size = prefix_length;
+        char const nul = '\0';
+        if (   -1 == buffer_append(&member, *cursor, suffix_length)
+            || -1 == buffer_append(&member, &nul, 1))
+        {
+            free(member.bytes);
+            return -1;
+        }
+        *cursor += suffix_length;
+        --member.size;
+        
+        char *string = (char *)member.bytes;
+        bool is_valid = strlen(string) == member.size;
+        if (is_valid && i) {
+            char const *last = stringset->members[stringset->count - 1];
+            is_valid = compare_strings(stringset->order, last, string) < 0;
+        }
+        if (!is_valid) {
+            free(member.bytes);
+            errno = EINVAL;
+            return -1;
+        }
+        
+        if (-1 == append(stringset, NULL, string)) {
+            free(member.bytes);
+            return -1;
+        }
+    }
+    
+    free(member.bytes);
+    return 0;
+}
+
+
+// Rebuild the filter of a string set after its members were replaced or
+// removed.  If that fails, the stale filter is dropped.
+static void
+refresh_filter(struct stringset *stringset)
+{
+    struct stringset_filter *filter = stringset->filter;
+    if (!filter) return;
+    
+    size_t capacity = filter->capacity;
+    if (capacity < stringset->count) capacity = 2 * stringset->count;
+    int result = rebuild_filter(stringset,
+                                capacity,
+                                filter->false_positive_rate);
+    if (-1 == result) drop_filter(stringset);
+}
+
+
+// Add a new member to the filter of a string set.  When the set outgrows the
+// filter, the filter is rebuilt at twice the size of the set.
+static void
+update_filter(struct stringset *stringset, char const *member)
+{
+    struct stringset_filter *filter = stringset->filter;
+    if (stringset->count > filter->capacity) {
+        int result = rebuild_filter(stringset,
+                                    2 * stringset->count,
+                                    filter->false_positive_rate);
+        if (0 == result) return;
+    }
+    filter_add(stringset->filter, hash_member(stringset, member));
+}
+
+
+// Add a string to a string set.  `source' is the string set that `string' is
+// a member of, or NULL.
+static int
+add_member(struct stringset *stringset,
+           struct stringset const *source,
+           char const *string)
+{
+    if (stringset_contains(stringset, string)) return 0;
+    if (MAX_COUNT == stringset->count) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    if (-1 == modify_members(stringset)) return -1;
+    
+    size_t new_index = stringset->count;
+    size_t new_count = stringset->count + 1;
+    if (-1 == reserve(stringset, new_count)) return -1;
+    if (stringset->is_deferred) {
+        int result = reserve_pending(stringset, stringset->pending_count + 1);
+        if (-1 == result) return -1;
+    }
+    
+    stringset->members[new_index] = copy_string(stringset, source, string);
+    if (!stringset->members[new_index]) return -1;
+    
+    stringset->count = new_count;
+    if (stringset->filter) {
+        update_filter(stringset, stringset->members[new_index]);
+    }
+    if (stringset->sketch) {
+        uint64_t hash = hash_member(stringset, stringset->members[new_index]);
+        sketch_add(stringset->sketch, hash);
+    }
+    
+    if (stringset->is_deferred) {
+        pending_insert(stringset->order,
+                       stringset->pending,
+                       stringset->pending_capacity,
+                       stringset->members[new_index]);
+        ++stringset->pending_count;
+        
+        size_t sorted_count = stringset->count - stringset->pending_count;
+        size_t max_pending_count = sorted_count / 8;
+        if (max_pending_count < MIN_PENDING_COUNT) {
+            max_pending_count = MIN_PENDING_COUNT;
+        }
+        if (stringset->pending_count > max_pending_count) {
+            merge_pending(stringset);
+        }
+        return 0;
+    }
+    
+    COUNT(stringset->stats, sorts, 1);
+    sort_strings(stringset->order, stringset->members, stringset->count);
+    
+    return 0;
+}
+
+
+// Update the filter and sketch of a string set for a new member.
+static void
+note_new_member(struct stringset *stringset, char const *member)
+{
+    if (stringset->filter) update_filter(stringset, member);
+    if (stringset->sketch) {
+        sketch_add(stringset->sketch, hash_member(stringset, member));
+    }
+}
+
+
+// Add strings sorted in the string set's order with no duplicates by merging
+// them with the members in one pass.  `source' is the string set that the
+// strings are members of, or NULL.
+static int
+merge_sorted_array(struct stringset *stringset,
+                   struct stringset const *source,
+                   char const *const *sorted,
+                   size_t count)
+{
+    if (!count) return 0;
+    
+    flush(stringset);
+    if (-1 == modify_members(stringset)) return -1;
+    
+    if (!stringset->count) {
+        if (-1 == reserve(stringset, count)) return -1;
+        for (size_t i = 0; i < count; ++i) {
+            if (-1 == append(stringset, source, sorted[i])) return -1;
+            note_new_member(stringset, stringset->members[i]);
+        }
+        return 0;
+    }
+    
+    // Copy the strings that aren't already members first, since that is the
+    // only step that can fail.
+    char **copies = alloc_memory(stringset, sizeof(char *) * count);
+    if (!copies) return -1;
+    size_t copies_count = 0;
+    int result = 0;
+    size_t i = 0;
+    for (size_t j = 0; j < count && 0 == result; ++j) {
+        int comparison = -1;
+        while (   i < stringset->count
+               && (comparison = compare_strings(stringset->order,
+                                                stringset->members[i],
+                                                sorted[j])) < 0)
+        {
+            ++i;
+        }
+        if (0 == comparison && i < stringset->count) continue;
+        
+        copies[copies_count] = copy_string(stringset, source, sorted[j]);
+        if (copies[copies_count]) {
+            ++copies_count;
+        } else {
+            result = -1;
+        }
+    }
+    
+    if (0 == result && copies_count > MAX_COUNT - stringset->count) {
+        errno = EOVERFLOW;
+        result = -1;
+    }
+    if (0 == result) {
+        result = reserve(stringset, stringset->count + copies_count);
+    }
+    if (-1 == result) {
+        for (size_t j = 0; j < copies_count; ++j) {
+            free_string(stringset, copies[j]);
+        }
+        free_memory(stringset, copies, sizeof(char *) * count);
+        return -1;
+    }
+    
+    // Merge backwards so that members are moved at most once.
+    i = stringset->count;
+    size_t j = copies_count;
+    size_t k = stringset->count + copies_count;
+    while (j) {
+        if (   i
+            && compare_strings(stringset->order,
+                               stringset->members[i - 1],
+                               copies[j - 1]) > 0)
+        {
+            stringset->members[--k] = stringset->members[--i];
+        } else {
+            stringset->members[--k] = copies[--j];
+        }
+    }
+    stringset->count += copies_count;
+    
+    for (j = 0; j < copies_count; ++j) {
+        note_new_member(stringset, copies[j]);
+    }
+    free_memory(stringset, copies, sizeof(char *) * count);
+    return 0;
+}
+
+
+// Add an array of strings to a string set.  `source' is the string set that
+// the strings are members of, or NULL.  If `is_sorted' is true, the strings
+// are sorted in the string set's order with no duplicates.
+static int
+add_array(struct stringset *stringset,
+          struct stringset const *source,
+          char const *const *array,
+          size_t count,
+          bool is_sorted)
+{
+    if (!count) return 0;
+    
+    // A deferred string set buffers a few strings as pending members more
+    // cheaply than it merges them with all of its members.
+    if (stringset->is_deferred && count <= stringset->count / 8) {
+        for (size_t i = 0; i < count; ++i) {
+            int result = add_member(stringset, source, array[i]);
+            if (-1 == result) return -1;
+        }
+        return 0;
+    }
+    
+    if (is_sorted) return merge_sorted_array(stringset, source, array, count);
+    
+    char const **sorted = alloc_sorted_array(stringset, array, count);
+    if (!sorted) return -1;
+    
+    size_t unique_count = remove_duplicates(stringset->order, sorted, count);
+    int result = merge_sorted_array(stringset, source, sorted, unique_count);
+    free_memory(stringset, sorted, sizeof(char *) * (count + 1));
+    return result;
+}
+
+
+// Prefetch the string of the member at `index', if there is one.
+static inline void
+prefetch_member(struct stringset const *stringset, size_t index)
+{
+    if (index < stringset->count) {
+        __builtin_prefetch(stringset->members[index]);
+    }
+}
+
+
+// A call to `stringset_parallel_for_each()' shared by its threads.
+// `next_index' is the first member of the next run to be claimed and
+// `result' is the first value other than 0 returned by the visitor.
+// `pending_count' counts the workers still visiting, guarded by
+// `workers_mutex'; the last one to finish signals `finished'.
+struct parallel_iteration {
+    struct stringset const *stringset;
+    stringset_visitor visitor;
+    void *context;
+    size_t next_index;
+    int result;
+    int pending_count;
+    pthread_cond_t finished;
+};
+
+
+// A thread kept to help later calls to `stringset_parallel_for_each()'.
+// It waits on `assigned' until it's given an `iteration', then returns to
+// the idle workers.
+struct parallel_worker {
+    struct parallel_worker *next;
+    struct parallel_iteration *iteration;
+    pthread_cond_t assigned;
+};
+
+
+// Worker threads are started as calls first need them and then kept for the
+// life of the process, so repeated calls don't create and join threads.
+static pthread_mutex_t workers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct parallel_worker *idle_workers;
+
+
+// Claim runs of members and visit them until every member has been claimed
+// or a visitor has stopped.
+static void *
+visit_runs(void *argument)
+{
+    struct parallel_iteration *iteration = argument;
+    struct stringset const *stringset = iteration->stringset;
+    while (!__atomic_load_n(&iteration->result, __ATOMIC_RELAXED)) {
+        size_t start = __atomic_fetch_add(&iteration->next_index,
+                                          PARALLEL_RUN_COUNT,
+                                          __ATOMIC_RELAXED);
+        if (start >= stringset->count) break;
+        
+        size_t end = stringset->count - start > PARALLEL_RUN_COUNT
+                   ? start + PARALLEL_RUN_COUNT
+                   : stringset->count;
+        for (size_t i = start; i < start + PREFETCH_DISTANCE && i < end; ++i) {
+            prefetch_member(stringset, i);
+        }
+        for (size_t i = start; i < end; ++i) {
+            if (i + PREFETCH_DISTANCE < end) {
+                prefetch_member(stringset, i + PREFETCH_DISTANCE);
+            }
+            int result = iteration->visitor(stringset->members[i],
+                                            iteration->context);
+            if (result) {
+                int expected = 0;
+                __atomic_compare_exchange_n(&iteration->result,
+                                            &expected,
+                                            result,
+                                            false,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED);
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+// Help the iterations assigned to a worker, forever.
+static void *
+run_worker(void *argument)
+{
+    struct parallel_worker *worker = argument;
+    pthread_mutex_lock(&workers_mutex);
+    for (;;) {
+        while (!worker->iteration) {
+            pthread_cond_wait(&worker->assigned, &workers_mutex);
+        }
+        struct parallel_iteration *iteration = worker->iteration;
+        pthread_mutex_unlock(&workers_mutex);
+        
+        visit_runs(iteration);
+        
+        pthread_mutex_lock(&workers_mutex);
+        worker->iteration = NULL;
+        worker->next = idle_workers;
+        idle_workers = worker;
+        if (0 == --iteration->pending_count) {
+            pthread_cond_signal(&iteration->finished);
+        }
+    }
+    return NULL;
+}
+
+
+// Take an idle worker, or start a new one if none is idle.  Must be called
+// with `workers_mutex' locked.  Returns NULL if a thread can't be started.
+static struct parallel_worker *
+take_worker(void)
+{
+    struct parallel_worker *worker = idle_workers;
+    if (worker) {
+        idle_workers = worker->next;
+        return worker;
+    }
+    
+    worker = calloc(1, sizeof(struct parallel_worker));
+    if (!worker) return NULL;
+    if (0 != pthread_cond_init(&worker->assigned, NULL)) {
+        free(worker);
+        return NULL;
+    }
+    pthread_attr_t attributes;
+    pthread_t thread;
+    int result = pthread_attr_init(&attributes);
+    if (0 == result) {
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        result = pthread_create(&thread, &attributes, run_worker, worker);
+        pthread_attr_destroy(&attributes);
+    }
+    if (0 != result) {
+        pthread_cond_destroy(&worker->assigned);
+        free(worker);
+        return NULL;
+    }
+    return worker;
+}
+
+
+struct stringset *
+stringset_alloc(void)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc);
+    return stringset_alloc_with_allocator(NULL);
+}
+
+
+struct stringset *
+stringset_alloc_at_least(struct stringset const *const *stringsets,
+                         int count,
+                         int min_count)
+{
+    BEGIN_OPERATION(count > 0 && stringsets ? stringsets[0] : NULL,
+                    stringset_operation_alloc_at_least);
+    if (   !is_valid_array(stringsets, count)
+        || min_count < 1
+        || min_count > count)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    return alloc_merged(stringsets, count, min_count);
+}
+
+
+struct stringset_delta *
+stringset_alloc_delta(struct stringset const *from,
+                      struct stringset const *to)
+{
+    BEGIN_BINARY_OPERATION(from, to, stringset_operation_alloc_delta);
+    if (!are_compatible(from, to)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset_delta *delta = calloc(1, sizeof(struct stringset_delta));
+    if (!delta) return NULL;
+    
+    struct stringset_options options = {
+        NULL, from->order, from->pool, false, false
+    };
+    delta->added = stringset_alloc_with_options(&options);
+    delta->removed = stringset_alloc_with_options(&options);
+    if (!delta->added || !delta->removed) {
+        stringset_delta_free(delta);
+        return NULL;
+    }
+    
+    flush(from);
+    flush(to);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < from->count || j < to->count) {
+        int order;
+        if (i == from->count) {
+            order = 1;
+        } else if (j == to->count) {
+            order = -1;
+        } else {
+            order = compare_strings(from->order,
+                                    from->members[i],
+                                    to->members[j]);
+        }
+        
+        int result = 0;
+        if (order < 0) {
+            result = append(delta->removed, from, from->members[i]);
+        } else if (order > 0) {
+            result = append(delta->added, to, to->members[j]);
+        }
+        if (-1 == result) {
+            stringset_delta_free(delta);
+            return NULL;
+        }
+        
+        if (order <= 0) ++i;
+        if (order >= 0) ++j;
+    }
+    
+    return delta;
+}
+
+
+struct stringset_delta *
+stringset_alloc_delta_from_bytes(void const *bytes, size_t size)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc_delta_from_bytes);
+    if (!bytes || size < sizeof delta_header + 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    unsigned char const *cursor = bytes;
+    unsigned char const *end = cursor + size;
+    if (   0 != memcmp(cursor, delta_header, sizeof delta_header)
+        || cursor[sizeof delta_header] > stringset_order_case_folded)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    struct stringset_options options = {
+        NULL,
+        (enum stringset_order)cursor[sizeof delta_header],
+        NULL,
+        false,
+        false
+    };
+    cursor += sizeof delta_header + 1;
+    
+    struct stringset_delta *delta = calloc(1, sizeof(struct stringset_delta));
+    if (!delta) return NULL;
+    
+    delta->added = stringset_alloc_with_options(&options);
+    delta->removed = stringset_alloc_with_options(&options);
+    if (!delta->added || !delta->removed) {
+        stringset_delta_free(delta);
+        return NULL;
+    }
+    
+    if (   -1 == read_members(&cursor, end, delta->added)
+        || -1 == read_members(&cursor, end, delta->removed))
+    {
+        stringset_delta_free(delta);
+        return NULL;
+    }
+    if (cursor != end) {
+        stringset_delta_free(delta);
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    return delta;
+}
+
+
+struct stringset *
+stringset_alloc_difference(struct stringset const *first,
+                           struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first, second, stringset_operation_alloc_difference);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = alloc_like(first);
+    if (!stringset) return NULL;
+    
+    int result = stringset_add_stringset(stringset, first);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    result = stringset_remove_stringset(stringset, second);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_from_array(char const *const *array, size_t count)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc_from_array);
+    if (!array) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = stringset_alloc();
+    if (!stringset) return NULL;
+    
+    int result = stringset_add_array(stringset, array, count);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_from_bytes(void const *bytes, size_t size)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc_from_bytes);
+    size_t header_size = sizeof stringset_header + 1;
+    if (!bytes || size < header_size + CHECKSUM_SIZE) {
+        errno = EINVAL;
+        return NULL;
+    }
+    unsigned char const *cursor = bytes;
+    unsigned char const *end = cursor + size - CHECKSUM_SIZE;
+    uint32_t checksum = (uint32_t)end[0]
+                      | (uint32_t)end[1] << 8
+                      | (uint32_t)end[2] << 16
+                      | (uint32_t)end[3] << 24;
+    if (   0 != memcmp(cursor, stringset_header, sizeof stringset_header)
+        || cursor[sizeof stringset_header] > stringset_order_case_folded
+        || checksum != crc32(cursor, size - CHECKSUM_SIZE))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    struct stringset_options options = {
+        NULL,
+        (enum stringset_order)cursor[sizeof stringset_header],
+        NULL,
+        false,
+        false
+    };
+    cursor += header_size;
+    
+    struct stringset *stringset = stringset_alloc_with_options(&options);
+    if (!stringset) return NULL;
+    
+    if (-1 == read_members(&cursor, end, stringset)) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    if (cursor != end) {
+        stringset_free(stringset);
+        errno = EINVAL;
+        return NULL;
+    }
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_from_sorted_array(char const *const *array, size_t count)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc_from_sorted_array);
+    if (!array) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = stringset_alloc();
+    if (!stringset) return NULL;
+    
+    int result = stringset_add_sorted_array(stringset, array, count);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_from_stringset(struct stringset const *stringset)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_alloc_from_stringset);
+    if (!stringset) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *copy = alloc_like(stringset);
+    if (!copy) return NULL;
+    
+    flush(stringset);
+    if (!stringset->count) return copy;
+    
+    // Share the members array copy-on-write.  The share count belongs to the
+    // array, so it is updated even though `stringset' is const, atomically
+    // so that the same string set can be cloned on several threads at once.
+    struct stringset *source = (struct stringset *)stringset;
+    size_t *share_count = __atomic_load_n(&source->share_count,
+                                          __ATOMIC_ACQUIRE);
+    if (!share_count) {
+        share_count = alloc_memory(source, sizeof(size_t));
+        if (!share_count) {
+            stringset_free(copy);
+            return NULL;
+        }
+        *share_count = 1;
+        
+        size_t *expected = NULL;
+        if (!__atomic_compare_exchange_n(&source->share_count,
+                                         &expected,
+                                         share_count,
+                                         false,
+                                         __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE))
+        {
+            free_memory(source, share_count, sizeof(size_t));
+            share_count = expected;
+        }
+    }
+    __atomic_add_fetch(share_count, 1, __ATOMIC_ACQ_REL);
+    copy->members = source->members;
+    copy->count = source->count;
+    copy->capacity = source->capacity;
+    copy->share_count = share_count;
+    
+    return copy;
+}
+
+
+struct stringset *
+stringset_alloc_intersection(struct stringset const *first,
+                             struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first,
+                           second,
+                           stringset_operation_alloc_intersection);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = alloc_like(first);
+    if (!stringset) return NULL;
+    
+    flush(first);
+    flush(second);
+    struct stringset const *smaller;
+    struct stringset const *larger;
+    if (first->count < second->count) {
+        smaller = first;
+        larger = second;
+    } else {
+        smaller = second;
+        larger = first;
+    }
+    
+    // Common members are found in order, so they are appended.
+    for (size_t i = 0; i < smaller->count; ++i) {
+        if (stringset_contains(larger, smaller->members[i])) {
+            int result = append(stringset, smaller, smaller->members[i]);
+            if (-1 == result) {
+                stringset_free(stringset);
+                return NULL;
+            }
+        }
+    }
+    
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_intersection_of(struct stringset const *const *stringsets,
+                                int count)
+{
+    BEGIN_OPERATION(count > 0 && stringsets ? stringsets[0] : NULL,
+                    stringset_operation_alloc_intersection_of);
+    if (!is_valid_array(stringsets, count)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = alloc_like(stringsets[0]);
+    if (!stringset) return NULL;
+    
+    // Sort the cursors by size so that the smallest set drives the search
+    // and the sets most likely to reject a candidate are searched first.
+    struct cursor *cursors = alloc_memory(stringset,
+                                          sizeof(struct cursor) * count);
+    if (!cursors) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    for (int i = 0; i < count; ++i) {
+        flush(stringsets[i]);
+        int j = i;
+        while (j > 0 && cursors[j - 1].count > stringsets[i]->count) {
+            cursors[j] = cursors[j - 1];
+            --j;
+        }
+        cursors[j].stringset = stringsets[i];
+        cursors[j].members = stringsets[i]->members;
+        cursors[j].count = stringsets[i]->count;
+        cursors[j].index = 0;
+    }
+    
+    int result = reserve(stringset, cursors[0].count);
+    for (size_t i = 0; -1 != result && i < cursors[0].count; ++i) {
+        char const *string = cursors[0].members[i];
+        bool is_common = true;
+        for (int j = 1; is_common && j < count; ++j) {
+            struct cursor *cursor = &cursors[j];
+            cursor->index = gallop(stringset->order,
+                                   cursor->members,
+                                   cursor->count,
+                                   cursor->index,
+                                   string);
+            is_common = cursor->index < cursor->count;
+            if (is_common) {
+                char const *member = cursor->members[cursor->index];
+                is_common = 0 == compare_strings(stringset->order,
+                                                 member,
+                                                 string);
+            }
+        }
+        if (is_common) result = append(stringset, cursors[0].stringset, string);
+    }
+    
+    free_memory(stringset, cursors, sizeof(struct cursor) * count);
+    if (-1 == result || -1 == stringset_compact(stringset)) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_symmetric_difference(struct stringset const *first,
+                                     struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first,
+                           second,
+                           stringset_operation_alloc_symmetric_difference);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = alloc_like(first);
+    if (!stringset) return NULL;
+    
+    flush(first);
+    flush(second);
+    
+    // Members of each string set that aren't in the other are found in
+    // order: those of `first' are appended and those of `second' merged in.
+    char const **others = NULL;
+    if (second->count) {
+        others = alloc_memory(stringset, sizeof(char *) * second->count);
+        if (!others) {
+            stringset_free(stringset);
+            return NULL;
+        }
+    }
+    size_t others_count = 0;
+    for (size_t i = 0; i < second->count; ++i) {
+        if (!stringset_contains(first, second->members[i])) {
+            others[others_count++] = second->members[i];
+        }
+    }
+    
+    int result = 0;
+    for (size_t i = 0; i < first->count && 0 == result; ++i) {
+        if (!stringset_contains(second, first->members[i])) {
+            result = append(stringset, first, first->members[i]);
+        }
+    }
+    if (0 == result) {
+        result = merge_sorted_array(stringset, second, others, others_count);
+    }
+    if (others) {
+        free_memory(stringset, others, sizeof(char *) * second->count);
+    }
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_union(struct stringset const *first,
+                      struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first, second, stringset_operation_alloc_union);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = alloc_like(first);
+    if (!stringset) return NULL;
+    
+    int result = stringset_add_stringset(stringset, first);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    result = stringset_add_stringset(stringset, second);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    
+    return stringset;
+}
+
+
+struct stringset *
+stringset_alloc_union_of(struct stringset const *const *stringsets,
+                         int count)
+{
+    BEGIN_OPERATION(count > 0 && stringsets ? stringsets[0] : NULL,
+                    stringset_operation_alloc_union_of);
+    if (!is_valid_array(stringsets, count)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    return alloc_merged(stringsets, count, 1);
+}
+
+
+struct stringset *
+stringset_alloc_with_allocator(struct stringset_allocator const *allocator)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc_with_allocator);
+    struct stringset_options options = {
+        allocator, stringset_order_lexical, NULL, false, false
+    };
+    return stringset_alloc_with_options(&options);
+}
+
+
+struct stringset *
+stringset_alloc_with_options(struct stringset_options const *options)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_alloc_with_options);
+    struct stringset_options default_options = {
+        NULL, stringset_order_lexical, NULL, false, false
+    };
+    if (!options) options = &default_options;
+    struct stringset_allocator default_allocator = { NULL, NULL, NULL, NULL };
+    struct stringset_allocator const *allocator = options->allocator;
+    if (!allocator) allocator = &default_allocator;
+    bool has_allocate = allocator->allocate;
+    if (   (!has_allocate && (allocator->reallocate || allocator->deallocate))
+        || options->order < stringset_order_lexical
+        || options->order > stringset_order_case_folded)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset;
+    if (allocator->allocate) {
+        stringset = allocator->allocate(sizeof(struct stringset),
+                                        allocator->context);
+    } else {
+        stringset = malloc(sizeof(struct stringset));
+    }
+    if (!stringset) return NULL;
+    
+    memset(stringset, 0, sizeof(struct stringset));
+    stringset->allocator = *allocator;
+    stringset->order = options->order;
+    stringset->pool = options->pool;
+    stringset->uses_huge_pages =    options->uses_huge_pages
+                                 || options->uses_explicit_huge_pages;
+    stringset->uses_explicit_huge_pages = options->uses_explicit_huge_pages;
+    return stringset;
+}
+
+
+int
+stringset_add(struct stringset *stringset, char const *string)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_add);
+    if (!stringset || !string) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return add_member(stringset, NULL, string);
+}
+
+
+int
+stringset_add_array(struct stringset *stringset,
+                    char const *const *array,
+                    size_t count)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_add_array);
+    if (!stringset || !array) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return add_array(stringset, NULL, array, count, false);
+}
+
+
+int
+stringset_add_sorted_array(struct stringset *stringset,
+                           char const *const *array,
+                           size_t count)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_add_sorted_array);
+    if (   !stringset
+        || !array
+        || !is_sorted_array(stringset->order, array, count))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return add_array(stringset, NULL, array, count, true);
+}
+
+
+int
+stringset_add_stringset(struct stringset *stringset,
+                        struct stringset const *other)
+{
+    BEGIN_BINARY_OPERATION(stringset, other, stringset_operation_add_stringset);
+    if (!are_compatible(stringset, other)) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    if (other == stringset) return 0;
+    
+    flush(other);
+    return add_array(stringset,
+                     other,
+                     (char const *const *)other->members,
+                     other->count,
+                     true);
+}
 
 
-static int
-add_array(struct stringset *stringset,
-          char const *const *array,
-          int count)
+int
+stringset_add_stringset_remove_common(struct stringset *stringset,
+                                      struct stringset const *other)
 {
-    if (!count) return 0;
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_add_stringset_remove_common);
+    if (!are_compatible(stringset, other)) {
+        errno = EINVAL;
+        return -1;
+    }
     
-    for (int i = 0; i < count; ++i) {
-        int result = stringset_add(stringset, array[i]);
-        if (-1 == result) return -1;
+    flush(stringset);
+    if (other == stringset) return stringset_clear(stringset);
+    if (-1 == modify_members(stringset)) return -1;
+    
+    flush(other);
+    size_t common_count = count_common(stringset, other);
+    size_t added_count = other->count - common_count;
+    size_t kept_count = stringset->count - common_count;
+    if (added_count > MAX_COUNT - kept_count) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    size_t new_count = kept_count + added_count;
+    size_t new_capacity = new_count;
+    char **new_members = NULL;
+    if (new_count) {
+        new_members = alloc_members(stringset, &new_capacity);
+        if (!new_members) return -1;
+    }
+    
+    // Copy the members only in `other' to the front of the new members array
+    // first, since that is the only step that can fail.
+    size_t copies_count = 0;
+    size_t i = 0;
+    for (size_t j = 0; j < other->count; ++j) {
+        while (   i < stringset->count
+               && compare_strings(stringset->order,
+                                  stringset->members[i],
+                                  other->members[j]) < 0)
+        {
+            ++i;
+        }
+        if (   i < stringset->count
+            && 0 == compare_strings(stringset->order,
+                                    stringset->members[i],
+                                    other->members[j]))
+        {
+            continue;
+        }
+        
+        char *copy = copy_string(stringset, other, other->members[j]);
+        if (!copy) {
+            for (size_t k = 0; k < copies_count; ++k) {
+                free_string(stringset, new_members[k]);
+            }
+            free_members(stringset, new_members, new_capacity);
+            return -1;
+        }
+        if (stringset->sketch) {
+            sketch_add(stringset->sketch, hash_member(stringset, copy));
+        }
+        new_members[copies_count++] = copy;
+    }
+    
+    // Merge backwards so that the copies at the front are never overwritten
+    // before they are moved, freeing the common members.
+    size_t new_index = new_count;
+    size_t copies_index = copies_count;
+    i = stringset->count;
+    size_t j = other->count;
+    while (i > 0) {
+        int order = j ? compare_strings(stringset->order,
+                                        stringset->members[i - 1],
+                                        other->members[j - 1]) : 1;
+        if (order > 0) {
+            new_members[--new_index] = stringset->members[--i];
+        } else if (order < 0) {
+            new_members[--new_index] = new_members[--copies_index];
+            --j;
+        } else {
+            free_string(stringset, stringset->members[--i]);
+            --j;
+        }
     }
     
+    free_members(stringset, stringset->members, stringset->capacity);
+    stringset->members = new_members;
+    stringset->count = new_count;
+    stringset->capacity = new_capacity;
+    refresh_filter(stringset);
+    
     return 0;
 }
 
 
-static int
-compare_strings(void const *first, void const *second)
+int
+stringset_apply_delta(struct stringset *stringset,
+                      struct stringset_delta const *delta)
 {
-    char *const *first_string = first;
-    char *const *second_string = second;
-    if (!*first_string && !*second_string) return 0;
-    if (!*first_string) return 1;
-    if (!*second_string) return -1;
-    return strcmp(*first_string, *second_string);
+    BEGIN_OPERATION(stringset, stringset_operation_apply_delta);
+    if (   !delta
+        || !are_compatible(stringset, delta->added)
+        || !are_compatible(stringset, delta->removed))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    struct stringset const *added = delta->added;
+    struct stringset const *removed = delta->removed;
+    flush(stringset);
+    flush(added);
+    flush(removed);
+    if (-1 == modify_members(stringset)) return -1;
+    
+    // Copy the added strings that aren't already members first, since that
+    // is the only step that can fail.
+    char **copies = NULL;
+    size_t copies_count = 0;
+    if (added->count) {
+        copies = alloc_memory(stringset, sizeof(char *) * added->count);
+        if (!copies) return -1;
+    }
+    for (size_t i = 0; i < added->count; ++i) {
+        if (find(stringset, added->members[i])) continue;
+        
+        copies[copies_count] = copy_string(stringset,
+                                           added,
+                                           added->members[i]);
+        if (!copies[copies_count]) {
+            for (size_t j = 0; j < copies_count; ++j) {
+                free_string(stringset, copies[j]);
+            }
+            free_memory(stringset, copies, sizeof(char *) * added->count);
+            return -1;
+        }
+        ++copies_count;
+    }
+    
+    bool is_too_large = copies_count > MAX_COUNT - stringset->count;
+    size_t new_capacity = is_too_large ? 0 : stringset->count + copies_count;
+    char **new_members = NULL;
+    if (new_capacity) new_members = alloc_members(stringset, &new_capacity);
+    if (is_too_large || (new_capacity && !new_members)) {
+        if (is_too_large) errno = EOVERFLOW;
+        for (size_t j = 0; j < copies_count; ++j) {
+            free_string(stringset, copies[j]);
+        }
+        free_memory(stringset, copies, sizeof(char *) * added->count);
+        return -1;
+    }
+    
+    size_t new_count = 0;
+    size_t i = 0;
+    size_t j = 0;
+    size_t k = 0;
+    while (i < stringset->count || j < copies_count) {
+        if (   j == copies_count
+            || (   i < stringset->count
+                && compare_strings(stringset->order,
+                                   stringset->members[i],
+                                   copies[j]) < 0))
+        {
+            char *member = stringset->members[i++];
+            while (   k < removed->count
+                   && compare_strings(stringset->order,
+                                      removed->members[k],
+                                      member) < 0)
+            {
+                ++k;
+            }
+            if (   k < removed->count
+                && 0 == compare_strings(stringset->order,
+                                        removed->members[k],
+                                        member))
+            {
+                free_string(stringset, member);
+                ++k;
+            } else {
+                new_members[new_count++] = member;
+            }
+        } else {
+            if (stringset->sketch) {
+                uint64_t hash = hash_member(stringset, copies[j]);
+                sketch_add(stringset->sketch, hash);
+            }
+            new_members[new_count++] = copies[j++];
+        }
+    }
+    
+    free_memory(stringset, copies, sizeof(char *) * added->count);
+    free_members(stringset, stringset->members, stringset->capacity);
+    stringset->members = new_members;
+    stringset->count = new_count;
+    stringset->capacity = new_capacity;
+    refresh_filter(stringset);
+    
+    return 0;
 }
 
 
-static int
-remove_array(struct stringset *stringset,
-             char const *const *array,
-             int count)
+int
+stringset_attach_sketch(struct stringset *stringset,
+                        struct stringset_sketch *sketch)
 {
-    for (int i = 0; i < count; ++i) {
-        int result = stringset_remove(stringset, array[i]);
-        if (-1 == result) return -1;
+    BEGIN_OPERATION(stringset, stringset_operation_attach_sketch);
+    if (!stringset) {
+        errno = EINVAL;
+        return -1;
     }
     
-    int result = stringset_compact(stringset);
-    if (-1 == result) return -1;
+    if (sketch) {
+        for (size_t i = 0; i < stringset->count; ++i) {
+            sketch_add(sketch, hash_member(stringset, stringset->members[i]));
+        }
+    }
+    stringset->sketch = sketch;
     
     return 0;
 }
 
 
-static void
-swap(struct stringset *first, struct stringset *second)
+int
+stringset_build_index(struct stringset *stringset)
 {
-    struct stringset temp = *first;
-    *first = *second;
-    *second = temp;
+    BEGIN_OPERATION(stringset, stringset_operation_build_index);
+    if (!stringset) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    flush(stringset);
+    struct stringset_index *index;
+    index = alloc_memory(stringset, sizeof(struct stringset_index));
+    if (!index) return -1;
+    
+    // Entry 0 is unused, and the prefixes are aligned to a cache line so that
+    // the entries three levels below any entry share one line.
+    size_t entry_count = stringset->count + 1;
+    size_t line_size = sizeof(uint64_t) * INDEX_LINE_PREFIXES;
+    size_t prefixes_size = sizeof(uint64_t) * entry_count + line_size;
+    index->memory_size = prefixes_size + sizeof(char *) * entry_count;
+    index->memory = alloc_memory(stringset, index->memory_size);
+    if (!index->memory) {
+        free_memory(stringset, index, sizeof(struct stringset_index));
+        return -1;
+    }
+    uintptr_t address = (uintptr_t)index->memory;
+    address = (address + line_size - 1) & ~(uintptr_t)(line_size - 1);
+    index->prefixes = (uint64_t *)address;
+    index->members = (char **)((char *)index->memory + prefixes_size);
+    index->count = stringset->count;
+    fill_index(stringset, index, 1, 0);
+    
+    drop_index(stringset);
+    stringset->index = index;
+    return 0;
 }
 
 
-struct stringset *
-stringset_alloc(void)
+int
+stringset_build_filter(struct stringset *stringset,
+                       double false_positive_rate)
 {
-    return calloc(1, sizeof(struct stringset));
+    BEGIN_OPERATION(stringset, stringset_operation_build_filter);
+    if (   !stringset
+        || !(false_positive_rate > 0.0)
+        || !(false_positive_rate < 1.0))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return rebuild_filter(stringset, stringset->count, false_positive_rate);
 }
 
 
-struct stringset *
-stringset_alloc_difference(struct stringset const *first,
-                           struct stringset const *second)
+int
+stringset_clear(struct stringset *stringset)
 {
-    struct stringset *stringset = stringset_alloc();
-    if (!stringset) return NULL;
-    
-    int result = stringset_add_stringset(stringset, first);
-    if (-1 == result) {
-        stringset_free(stringset);
-        return NULL;
+    BEGIN_OPERATION(stringset, stringset_operation_clear);
+    if (!stringset) {
+        errno = EINVAL;
+        return -1;
     }
     
-    result = stringset_remove_stringset(stringset, second);
-    if (-1 == result) {
-        stringset_free(stringset);
-        return NULL;
+    drop_index(stringset);
+    if (is_shared(stringset)) {
+        // Leave the members to the clones that share them, unless they let
+        // go of them in the meantime.
+        release_shared_members(stringset);
+        stringset->members = NULL;
+        stringset->capacity = 0;
+    } else {
+        unshare_members(stringset);
+        if (frees_members(stringset)) {
+            for (size_t i = 0; i < stringset->count; ++i) {
+                free_string(stringset, stringset->members[i]);
+            }
+        }
+    }
+    stringset->count = 0;
+    if (stringset->pending_count) {
+        size_t pending_size = sizeof(char *) * stringset->pending_capacity;
+        memset(stringset->pending, 0, pending_size);
+        stringset->pending_count = 0;
+    }
+    if (stringset->filter) {
+        struct stringset_filter *filter = stringset->filter;
+        size_t blocks_size = sizeof(uint64_t) * FILTER_BLOCK_WORDS
+                           * filter->block_count;
+        memset(filter->blocks, 0, blocks_size);
+        filter->is_stale = false;
     }
+    stringset_compact(stringset);
     
-    return stringset;
+    return 0;
 }
 
 
-struct stringset *
-stringset_alloc_from_array(char const *const *array, int count)
+int
+stringset_compact(struct stringset *stringset)
 {
-    if (!array || count < 0) {
+    BEGIN_OPERATION(stringset, stringset_operation_compact);
+    if (!stringset) {
         errno = EINVAL;
-        return NULL;
+        return -1;
     }
     
-    struct stringset *stringset = stringset_alloc();
-    if (!stringset) return NULL;
+    flush(stringset);
+    if (is_shared(stringset)) return 0;
+    if (-1 == resize_members(stringset, stringset->count)) return -1;
+    if (stringset->filter && stringset->filter->is_stale) {
+        refresh_filter(stringset);
+    }
     
-    int result = stringset_add_array(stringset, array, count);
-    if (-1 == result) {
-        stringset_free(stringset);
-        return NULL;
+    return 0;
+}
+
+
+bool
+stringset_contains(struct stringset const *stringset, char const *string)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_contains);
+    if (!stringset || !string) {
+        errno = EINVAL;
+        return false;
     }
     
-    return stringset;
+    if (stringset->filter) {
+        uint64_t hash = hash_member(stringset, string);
+        if (!filter_may_contain(stringset->filter, hash)) return false;
+    }
+    if (stringset->index) return index_contains(stringset, string);
+    if (find(stringset, string)) return true;
+    return pending_contains(stringset, string);
 }
 
 
-struct stringset *
-stringset_alloc_from_stringset(struct stringset const *stringset)
+size_t
+stringset_count_difference(struct stringset const *first,
+                           struct stringset const *second)
 {
-    if (!stringset) {
+    BEGIN_BINARY_OPERATION(first, second, stringset_operation_count_difference);
+    if (!are_compatible(first, second)) {
         errno = EINVAL;
-        return NULL;
+        return 0;
     }
     
-    return stringset_alloc_from_array((char const **)stringset->members,
-                                      stringset->count);
+    flush(first);
+    flush(second);
+    size_t common_count = count_common(first, second);
+    return first->count - common_count;
 }
 
 
-struct stringset *
-stringset_alloc_intersection(struct stringset const *first,
+size_t
+stringset_count_intersection(struct stringset const *first,
                              struct stringset const *second)
 {
-    if (!first || !second) {
+    BEGIN_BINARY_OPERATION(first,
+                           second,
+                           stringset_operation_count_intersection);
+    if (!are_compatible(first, second)) {
         errno = EINVAL;
-        return NULL;
+        return 0;
     }
     
-    struct stringset *stringset = stringset_alloc();
-    if (!stringset) return NULL;
-    
-    struct stringset const *smaller;
-    struct stringset const *larger;
-    if (first->count < second->count) {
-        smaller = first;
-        larger = second;
-    } else {
-        smaller = second;
-        larger = first;
+    flush(first);
+    flush(second);
+    return count_common(first, second);
+}
+
+
+size_t
+stringset_count_symmetric_difference(struct stringset const *first,
+                                     struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first,
+                           second,
+                           stringset_operation_count_symmetric_difference);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return 0;
     }
     
-    for (int i = 0; i < smaller->count; ++i) {
-        if (stringset_contains(larger, smaller->members[i])) {
-            int result = stringset_add(stringset, smaller->members[i]);
-            if (-1 == result) {
-                stringset_free(stringset);
-                return NULL;
-            }
-        }
+    flush(first);
+    flush(second);
+    size_t common_count = count_common(first, second);
+    return first->count - common_count + (second->count - common_count);
+}
+
+
+size_t
+stringset_count_union(struct stringset const *first,
+                      struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first, second, stringset_operation_count_union);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return 0;
     }
     
-    return stringset;
+    flush(first);
+    flush(second);
+    size_t common_count = count_common(first, second);
+    return first->count - common_count + second->count;
 }
 
 
-struct stringset *
-stringset_alloc_symmetric_difference(struct stringset const *first,
-                                     struct stringset const *second)
+void
+stringset_cursor_init(struct stringset_cursor *cursor,
+                      struct stringset const *stringset,
+                      bool is_reverse)
 {
-    struct stringset *stringset = stringset_alloc();
-    if (!stringset) return NULL;
+    if (!cursor) return;
     
-    for (int i = 0; i < first->count; ++i) {
-        if (!stringset_contains(second, first->members[i])) {
-            int result = stringset_add(stringset, first->members[i]);
-            if (-1 == result) {
-                stringset_free(stringset);
-                return NULL;
-            }
+    cursor->stringset = stringset;
+    cursor->is_reverse = is_reverse;
+    cursor->index = 0;
+    if (stringset) {
+        flush(stringset);
+        if (is_reverse) cursor->index = stringset->count;
+        for (size_t i = 0; i < PREFETCH_DISTANCE; ++i) {
+            prefetch_member(stringset,
+                            is_reverse ? cursor->index - 1 - i : i);
         }
     }
+}
+
+
+char const *
+stringset_cursor_next(struct stringset_cursor *cursor)
+{
+    if (!cursor || !cursor->stringset) return NULL;
     
-    for (int i = 0; i < second->count; ++i) {
-        if (!stringset_contains(first, second->members[i])) {
-            int result = stringset_add(stringset, second->members[i]);
-            if (-1 == result) {
-                stringset_free(stringset);
-                return NULL;
-            }
-        }
+    // `index' is the index of the next member when going forward, or one
+    // past it in reverse.  Indexes before the first member wrap around and
+    // are ignored by `prefetch_member()'.
+    struct stringset const *stringset = cursor->stringset;
+    size_t index;
+    if (cursor->is_reverse) {
+        if (0 == cursor->index) return NULL;
+        index = --cursor->index;
+        prefetch_member(stringset, index - PREFETCH_DISTANCE);
+    } else {
+        if (cursor->index >= stringset->count) return NULL;
+        index = cursor->index++;
+        prefetch_member(stringset, index + PREFETCH_DISTANCE);
     }
-    
-    return stringset;
+    return stringset->members[index];
 }
 
 
-struct stringset *
-stringset_alloc_union(struct stringset const *first,
-                      struct stringset const *second)
+void
+stringset_delta_free(struct stringset_delta *delta)
 {
-    if (!first || !second) {
-        errno = EINVAL;
-        return NULL;
+    if (delta) {
+        stringset_free(delta->added);
+        stringset_free(delta->removed);
+        free(delta);
     }
-    
-    struct stringset *stringset = stringset_alloc();
-    if (!stringset) return NULL;
-    
-    int result = stringset_add_stringset(stringset, first);
-    if (-1 == result) {
-        stringset_free(stringset);
+}
+
+
+void *
+stringset_delta_serialize(struct stringset_delta const *delta, size_t *size)
+{
+    BEGIN_OPERATION(NULL, stringset_operation_delta_serialize);
+    if (   !delta
+        || !are_compatible(delta->added, delta->removed)
+        || !size)
+    {
+        errno = EINVAL;
         return NULL;
     }
     
-    result = stringset_add_stringset(stringset, second);
-    if (-1 == result) {
-        stringset_free(stringset);
+    flush(delta->added);
+    flush(delta->removed);
+    struct buffer buffer = { NULL, 0, 0 };
+    unsigned char const order = delta->added->order;
+    if (   -1 == buffer_append(&buffer, delta_header, sizeof delta_header)
+        || -1 == buffer_append(&buffer, &order, 1)
+        || -1 == buffer_append_members(&buffer, delta->added)
+        || -1 == buffer_append_members(&buffer, delta->removed))
+    {
+        free(buffer.bytes);
         return NULL;
     }
     
-    return stringset;
+    *size = buffer.size;
+    return buffer.bytes;
 }
 
 
 int
-stringset_add(struct stringset *stringset, char const *string)
+stringset_drop_index(struct stringset *stringset)
 {
-    if (!stringset || !string) {
+    BEGIN_OPERATION(stringset, stringset_operation_drop_index);
+    if (!stringset) {
         errno = EINVAL;
         return -1;
-    }
-    
-    if (stringset_contains(stringset, string)) return 0;
-    
-    int new_index = stringset->count;
-    int new_count = stringset->count + 1;
-    size_t new_size = sizeof(char *) * new_count;
-    char **new_members = realloc(stringset->members, new_size);
-    if (!new_members) return -1;
-    
-    stringset->members = new_members;
-    stringset->members[new_index] = strdup(string);
-    if (!stringset->members[new_index]) return -1;
-    
-    stringset->count = new_count;
-    
-    qsort(stringset->members,
-          stringset->count,
-          sizeof(char *),
-          compare_strings);
+    }
     
+    drop_index(stringset);
     return 0;
 }
 
 
 int
-stringset_add_array(struct stringset *stringset,
-                    char const *const *array,
-                    int count)
+stringset_drop_filter(struct stringset *stringset)
 {
-    if (!stringset || !array || count < 0) {
+    BEGIN_OPERATION(stringset, stringset_operation_drop_filter);
+    if (!stringset) {
         errno = EINVAL;
         return -1;
     }
     
-    return add_array(stringset, array, count);
+    drop_filter(stringset);
+    return 0;
 }
 
 
 int
-stringset_add_stringset(struct stringset *stringset,
-                        struct stringset const *other)
+stringset_flush(struct stringset *stringset)
 {
-    if (!stringset || !other) {
+    BEGIN_OPERATION(stringset, stringset_operation_flush);
+    if (!stringset) {
         errno = EINVAL;
         return -1;
     }
     
-    return add_array(stringset,
-                     (char const *const *)other->members,
-                     other->count);
+    flush(stringset);
+    return 0;
 }
 
 
 int
-stringset_add_stringset_remove_common(struct stringset *stringset,
-                                      struct stringset const *other)
+stringset_for_each(struct stringset const *stringset,
+                   stringset_visitor visitor,
+                   void *context)
 {
-    if (!stringset || !other) {
+    BEGIN_OPERATION(stringset, stringset_operation_for_each);
+    if (!stringset || !visitor) {
         errno = EINVAL;
         return -1;
     }
     
-    for (int i = 0; i < other->count; ++i) {
-        if (stringset_contains(stringset, other->members[i])) {
-            int result = stringset_remove(stringset, other->members[i]);
-            if (-1 == result) return -1;
-        } else {
-            int result = stringset_add(stringset, other->members[i]);
-            if (-1 == result) return -1;
-        }
+    flush(stringset);
+    for (size_t i = 0; i < PREFETCH_DISTANCE; ++i) {
+        prefetch_member(stringset, i);
+    }
+    for (size_t i = 0; i < stringset->count; ++i) {
+        prefetch_member(stringset, i + PREFETCH_DISTANCE);
+        int result = visitor(stringset->members[i], context);
+        if (result) return result;
     }
-    
     return 0;
 }
 
 
-int
-stringset_clear(struct stringset *stringset)
+void
+stringset_free(struct stringset *stringset)
 {
-    if (!stringset) {
-        errno = EINVAL;
-        return -1;
+    BEGIN_OPERATION(stringset, stringset_operation_free);
+    if (stringset) {
+        stringset_clear(stringset);
+        drop_filter(stringset);
+        free_memory(stringset,
+                    stringset->pending,
+                    sizeof(char *) * stringset->pending_capacity);
+        release_slab(stringset->slab);
+        
+        struct stringset_allocator allocator = stringset->allocator;
+        deallocate(&allocator, stringset);
     }
-    
-    for (int i = 0; i < stringset->count; ++i) {
-        free(stringset->members[i]);
+}
+
+
+void
+stringset_get_global_stats(struct stringset_stats *stats)
+{
+    if (!stats) return;
+
+#ifdef STRINGSET_STATS
+    void const *global_counters = &global_stats;
+    unsigned long long const *counters = global_counters;
+    unsigned long long *copies = (unsigned long long *)stats;
+    size_t counters_count = sizeof(struct stringset_stats) / sizeof *counters;
+    for (size_t i = 0; i < counters_count; ++i) {
+        copies[i] = __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
     }
-    stringset->count = 0;
-    stringset_compact(stringset);
-    
-    return 0;
+#else
+    stringset_reset_stats(stats);
+#endif
 }
 
 
 int
-stringset_compact(struct stringset *stringset)
+stringset_get_histogram(enum stringset_operation operation,
+                        struct stringset_histogram *histogram)
 {
-    if (!stringset) {
+    if (operation < 0 || operation >= stringset_operation_count || !histogram) {
         errno = EINVAL;
         return -1;
     }
-    
-    if (stringset->count) {
-        size_t new_size = sizeof(char *) * stringset->count;
-        char **new_members = realloc(stringset->members, new_size);
-        if (!new_members) return -1;
-        stringset->members = new_members;
-    } else {
-        free(stringset->members);
-        stringset->members = NULL;
+
+#ifdef STRINGSET_TRACE
+    for (int i = 0; i < STRINGSET_HISTOGRAM_BUCKETS; ++i) {
+        histogram->counts[i] = __atomic_load_n(&histograms[operation][i],
+                                               __ATOMIC_RELAXED);
     }
-    
+#else
+    memset(histogram, 0, sizeof(struct stringset_histogram));
+#endif
     return 0;
 }
 
 
-bool
-stringset_contains(struct stringset const *stringset, char const *string)
+unsigned long long
+stringset_histogram_quantile(struct stringset_histogram const *histogram,
+                             double quantile)
 {
-    if (!stringset || !string) {
+    if (!histogram || !(quantile >= 0.0 && quantile <= 1.0)) {
         errno = EINVAL;
-        return false;
+        return 0;
     }
     
-    void *found = bsearch(&string,
-                          stringset->members,
-                          stringset->count,
-                          sizeof(char *),
-                          compare_strings);
-    return found ? true : false;
-}
-
-
-void
-stringset_free(struct stringset *stringset)
-{
-    if (stringset) {
-        stringset_clear(stringset);
-        free(stringset);
+    unsigned long long total = 0;
+    for (int i = 0; i < STRINGSET_HISTOGRAM_BUCKETS; ++i) {
+        total += histogram->counts[i];
     }
+    if (!total) return 0;
+    
+    unsigned long long rank = (unsigned long long)ceil(quantile * total);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    
+    int bucket = 0;
+    unsigned long long seen = histogram->counts[0];
+    while (seen < rank) seen += histogram->counts[++bucket];
+    
+    // Return one less than the first latency of the next bucket.
+    int next = bucket + 1;
+    if (next < 8) return (unsigned long long)next - 1;
+    int exponent = next / 8 + 2;
+    return ((8ULL + next % 8) << (exponent - 3)) - 1;
 }
 
 
@@ -372,11 +3942,16 @@ bool
 stringset_is_disjoint_from(struct stringset const *stringset,
                            struct stringset const *other)
 {
-    if (!stringset || !other) {
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_is_disjoint_from);
+    if (!are_compatible(stringset, other)) {
         errno = EINVAL;
         return false;
     }
     
+    flush(stringset);
+    flush(other);
     struct stringset const *smaller;
     struct stringset const *larger;
     if (stringset->count < other->count) {
@@ -387,7 +3962,7 @@ stringset_is_disjoint_from(struct stringset const *stringset,
         larger = stringset;
     }
     
-    for (int i = 0; i < smaller->count; ++i) {
+    for (size_t i = 0; i < smaller->count; ++i) {
         if (stringset_contains(larger, smaller->members[i])) return false;
     }
     return true;
@@ -398,12 +3973,25 @@ bool
 stringset_is_equal_to(struct stringset const *stringset,
                       struct stringset const *other)
 {
-    if (!stringset || !other) {
+    BEGIN_BINARY_OPERATION(stringset, other, stringset_operation_is_equal_to);
+    if (!are_compatible(stringset, other)) {
         errno = EINVAL;
         return false;
     }
     
     if (stringset->count != other->count) return false;
+    
+    // Equal members of sets that share a pool are the same interned string,
+    // unless the order folds case.
+    if (   stringset->pool
+        && stringset->pool == other->pool
+        && stringset_order_case_folded != stringset->order)
+    {
+        flush(stringset);
+        flush(other);
+        size_t size = sizeof(char *) * stringset->count;
+        return !size || 0 == memcmp(stringset->members, other->members, size);
+    }
     return stringset_is_subset_of(stringset, other);
 }
 
@@ -412,7 +4000,10 @@ bool
 stringset_is_proper_subset_of(struct stringset const *stringset,
                               struct stringset const *other)
 {
-    if (!stringset || !other) {
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_is_proper_subset_of);
+    if (!are_compatible(stringset, other)) {
         errno = EINVAL;
         return false;
     }
@@ -420,7 +4011,8 @@ stringset_is_proper_subset_of(struct stringset const *stringset,
     if (stringset == other) return false;
     if (stringset->count >= other->count) return false;
     
-    for (int i = 0; i < stringset->count; ++i) {
+    flush(stringset);
+    for (size_t i = 0; i < stringset->count; ++i) {
         if (!stringset_contains(other, stringset->members[i])) return false;
     }
     return true;
@@ -431,6 +4023,9 @@ bool
 stringset_is_proper_superset_of(struct stringset const *stringset,
                                 struct stringset const *other)
 {
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_is_proper_superset_of);
     return stringset_is_proper_subset_of(other, stringset);
 }
 
@@ -439,7 +4034,8 @@ bool
 stringset_is_subset_of(struct stringset const *stringset,
                        struct stringset const *other)
 {
-    if (!stringset || !other) {
+    BEGIN_BINARY_OPERATION(stringset, other, stringset_operation_is_subset_of);
+    if (!are_compatible(stringset, other)) {
         errno = EINVAL;
         return false;
     }
@@ -447,7 +4043,8 @@ stringset_is_subset_of(struct stringset const *stringset,
     if (stringset == other) return true;
     if (stringset->count > other->count) return false;
     
-    for (int i = 0; i < stringset->count; ++i) {
+    flush(stringset);
+    for (size_t i = 0; i < stringset->count; ++i) {
         if (!stringset_contains(other, stringset->members[i])) return false;
     }
     return true;
@@ -458,31 +4055,135 @@ bool
 stringset_is_superset_of(struct stringset const *stringset,
                          struct stringset const *other)
 {
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_is_superset_of);
     return stringset_is_subset_of(other, stringset);
 }
 
 
+double
+stringset_jaccard_similarity(struct stringset const *first,
+                             struct stringset const *second)
+{
+    BEGIN_BINARY_OPERATION(first,
+                           second,
+                           stringset_operation_jaccard_similarity);
+    if (!are_compatible(first, second)) {
+        errno = EINVAL;
+        return -1.0;
+    }
+    
+    flush(first);
+    flush(second);
+    size_t common_count = count_common(first, second);
+    double union_count = (double)first->count + second->count - common_count;
+    if (!union_count) return 1.0;
+    return common_count / union_count;
+}
+
+
+char const *
+stringset_operation_name(enum stringset_operation operation)
+{
+    if (operation < 0 || operation >= stringset_operation_count) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    return operation_names[operation];
+}
+
+
+int
+stringset_parallel_for_each(struct stringset const *stringset,
+                            int threads_count,
+                            stringset_visitor visitor,
+                            void *context)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_parallel_for_each);
+    if (!stringset || threads_count < 1 || !visitor) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    flush(stringset);
+    struct parallel_iteration iteration = {
+        stringset, visitor, context, 0, 0, 0, PTHREAD_COND_INITIALIZER
+    };
+    
+    // There is no point in waking workers that would find no run left.
+    size_t runs_count = stringset->count / PARALLEL_RUN_COUNT + 1;
+    if ((size_t)threads_count > runs_count) threads_count = (int)runs_count;
+    
+    if (threads_count > 1) {
+        pthread_mutex_lock(&workers_mutex);
+        while (iteration.pending_count < threads_count - 1) {
+            struct parallel_worker *worker = take_worker();
+            if (!worker) break;
+            worker->iteration = &iteration;
+            ++iteration.pending_count;
+            pthread_cond_signal(&worker->assigned);
+        }
+        pthread_mutex_unlock(&workers_mutex);
+    }
+    
+    visit_runs(&iteration);
+    pthread_mutex_lock(&workers_mutex);
+    while (iteration.pending_count) {
+        pthread_cond_wait(&iteration.finished, &workers_mutex);
+    }
+    pthread_mutex_unlock(&workers_mutex);
+    pthread_cond_destroy(&iteration.finished);
+    return iteration.result;
+}
+
+
+struct stringset_pool *
+stringset_pool_alloc(void)
+{
+    return calloc(1, sizeof(struct stringset_pool));
+}
+
+
+size_t
+stringset_pool_count(struct stringset_pool const *pool)
+{
+    return pool ? pool->count : 0;
+}
+
+
+void
+stringset_pool_free(struct stringset_pool *pool)
+{
+    if (pool) {
+        for (size_t i = 0; i < pool->capacity; ++i) free(pool->slots[i]);
+        free(pool->slots);
+        free(pool);
+    }
+}
+
+
 int
 stringset_remove(struct stringset *stringset, char const *string)
 {
+    BEGIN_OPERATION(stringset, stringset_operation_remove);
     if (!stringset || !string) {
         errno = EINVAL;
         return -1;
     }
     
-    void *found = bsearch(&string,
-                          stringset->members,
-                          stringset->count,
-                          sizeof(char *),
-                          compare_strings);
-    if (found) {
-        char **member = found;
-        *member = NULL;
+    flush(stringset);
+    char **member = find(stringset, string);
+    if (member) {
+        ptrdiff_t index = member - stringset->members;
+        if (-1 == modify_members(stringset)) return -1;
+        member = stringset->members + index;
         
-        qsort(stringset->members,
-              stringset->count,
-              sizeof(char *),
-              compare_strings);
+        free_string(stringset, *member);
+        char **end = stringset->members + stringset->count;
+        memmove(member, member + 1, sizeof(char *) * (end - member - 1));
+        if (stringset->filter) stringset->filter->is_stale = true;
         
         --stringset->count;
     }
@@ -494,9 +4195,10 @@ stringset_remove(struct stringset *stringset, char const *string)
 int
 stringset_remove_array(struct stringset *stringset,
                        char const *const *array,
-                       int count)
+                       size_t count)
 {
-    if (!stringset || !array || count < 0) {
+    BEGIN_OPERATION(stringset, stringset_operation_remove_array);
+    if (!stringset || !array) {
         errno = EINVAL;
         return -1;
     }
@@ -509,33 +4211,86 @@ int
 stringset_remove_stringset(struct stringset *stringset,
                            struct stringset const *other)
 {
-    if (!stringset || !other) {
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_remove_stringset);
+    if (!are_compatible(stringset, other)) {
         errno = EINVAL;
         return -1;
     }
     
-    return remove_array(stringset,
-                        (char const *const *)other->members,
-                        other->count);
+    flush(stringset);
+    if (other == stringset) return stringset_clear(stringset);
+    if (-1 == modify_members(stringset)) return -1;
+    
+    flush(other);
+    keep_members(stringset,
+                 (char const *const *)other->members,
+                 other->count,
+                 false);
+    return stringset_compact(stringset);
+}
+
+
+void
+stringset_reset_global_stats(void)
+{
+#ifdef STRINGSET_STATS
+    unsigned long long *counters = (unsigned long long *)&global_stats;
+    size_t counters_count = sizeof(struct stringset_stats) / sizeof *counters;
+    for (size_t i = 0; i < counters_count; ++i) {
+        __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+#endif
+}
+
+
+void
+stringset_reset_histograms(void)
+{
+#ifdef STRINGSET_TRACE
+    for (int i = 0; i < stringset_operation_count; ++i) {
+        for (int j = 0; j < STRINGSET_HISTOGRAM_BUCKETS; ++j) {
+            __atomic_store_n(&histograms[i][j], 0, __ATOMIC_RELAXED);
+        }
+    }
+#endif
+}
+
+
+void
+stringset_reset_stats(struct stringset_stats *stats)
+{
+    if (stats) memset(stats, 0, sizeof(struct stringset_stats));
 }
 
 
 int
 stringset_retain_array(struct stringset *stringset,
                        char const *const *array,
-                       int count)
+                       size_t count)
 {
-    if (!stringset || !array || count < 0) {
+    BEGIN_OPERATION(stringset, stringset_operation_retain_array);
+    if (!stringset || !array) {
         errno = EINVAL;
         return -1;
     }
     
-    struct stringset *other = stringset_alloc_from_array(array, count);
-    if (!other) return -1;
+    char const **sorted = alloc_sorted_array(stringset, array, count);
+    if (!sorted) return -1;
     
-    int result = stringset_retain_stringset(stringset, other);
-    stringset_free(other);
-    return result;
+    flush(stringset);
+    if (-1 == modify_members(stringset)) {
+        free_memory(stringset, sorted, sizeof(char *) * (count + 1));
+        return -1;
+    }
+    keep_members(stringset, sorted, count, true);
+    free_memory(stringset, sorted, sizeof(char *) * (count + 1));
+    if (stringset->filter && stringset->filter->is_stale) {
+        refresh_filter(stringset);
+    }
+    
+    return 0;
 }
 
 
@@ -543,16 +4298,273 @@ int
 stringset_retain_stringset(struct stringset *stringset,
                            struct stringset const *other)
 {
-    if (!stringset || !other) {
+    BEGIN_BINARY_OPERATION(stringset,
+                           other,
+                           stringset_operation_retain_stringset);
+    if (!are_compatible(stringset, other)) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    flush(stringset);
+    if (other == stringset) return 0;
+    if (-1 == modify_members(stringset)) return -1;
+    
+    flush(other);
+    keep_members(stringset,
+                 (char const *const *)other->members,
+                 other->count,
+                 true);
+    if (stringset->filter && stringset->filter->is_stale) {
+        refresh_filter(stringset);
+    }
+    
+    return 0;
+}
+
+
+void *
+stringset_serialize(struct stringset const *stringset, size_t *size)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_serialize);
+    if (!stringset || !size) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    flush(stringset);
+    struct buffer buffer = { NULL, 0, 0 };
+    unsigned char const order = stringset->order;
+    if (   -1 == buffer_append(&buffer,
+                               stringset_header,
+                               sizeof stringset_header)
+        || -1 == buffer_append(&buffer, &order, 1)
+        || -1 == buffer_append_members(&buffer, stringset))
+    {
+        free(buffer.bytes);
+        return NULL;
+    }
+    
+    uint32_t checksum = crc32(buffer.bytes, buffer.size);
+    unsigned char const checksum_bytes[CHECKSUM_SIZE] = {
+        checksum & 0xff,
+        checksum >> 8 & 0xff,
+        checksum >> 16 & 0xff,
+        checksum >> 24 & 0xff
+    };
+    if (-1 == buffer_append(&buffer, checksum_bytes, CHECKSUM_SIZE)) {
+        free(buffer.bytes);
+        return NULL;
+    }
+    
+    *size = buffer.size;
+    return buffer.bytes;
+}
+
+
+int
+stringset_set_deferred(struct stringset *stringset, bool is_deferred)
+{
+    BEGIN_OPERATION(stringset, stringset_operation_set_deferred);
+    if (!stringset) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    if (!is_deferred) {
+        flush(stringset);
+        free_memory(stringset,
+                    stringset->pending,
+                    sizeof(char *) * stringset->pending_capacity);
+        stringset->pending = NULL;
+        stringset->pending_capacity = 0;
+    }
+    stringset->is_deferred = is_deferred;
+    
+    return 0;
+}
+
+
+int
+stringset_set_stats(struct stringset *stringset,
+                    struct stringset_stats *stats)
+{
+    if (!stringset) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    stringset->stats = stats;
+    return 0;
+}
+
+
+void
+stringset_set_trace_hooks(stringset_trace_hook begin,
+                          stringset_trace_hook end,
+                          void *context)
+{
+#ifdef STRINGSET_TRACE
+    begin_hook = begin;
+    end_hook = end;
+    hooks_context = context;
+#else
+    (void)begin;
+    (void)end;
+    (void)context;
+#endif
+}
+
+
+struct stringset_sketch *
+stringset_sketch_alloc(int precision)
+{
+    if (precision < MIN_SKETCH_PRECISION || precision > MAX_SKETCH_PRECISION) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    size_t register_count = (size_t)1 << precision;
+    struct stringset_sketch *sketch;
+    sketch = calloc(1, sizeof(struct stringset_sketch) + register_count);
+    if (!sketch) return NULL;
+    
+    sketch->precision = precision;
+    return sketch;
+}
+
+
+struct stringset_sketch *
+stringset_sketch_alloc_from_stringset(struct stringset const *stringset,
+                                      int precision)
+{
+    BEGIN_OPERATION(stringset,
+                    stringset_operation_sketch_alloc_from_stringset);
+    if (!stringset) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset_sketch *sketch = stringset_sketch_alloc(precision);
+    if (!sketch) return NULL;
+    
+    for (size_t i = 0; i < stringset->count; ++i) {
+        sketch_add(sketch, hash_member(stringset, stringset->members[i]));
+    }
+    return sketch;
+}
+
+
+int
+stringset_sketch_add(struct stringset_sketch *sketch, char const *string)
+{
+    if (!sketch || !string) {
         errno = EINVAL;
         return -1;
     }
     
-    struct stringset *intersection = stringset_alloc_intersection(stringset, other);
-    if (!intersection) return -1;
+    uint64_t hash = mix_hash(hash_string(stringset_order_lexical, string));
+    sketch_add(sketch, hash);
+    return 0;
+}
+
+
+double
+stringset_sketch_estimate(struct stringset_sketch const *sketch)
+{
+    if (!sketch) {
+        errno = EINVAL;
+        return -1.0;
+    }
+    
+    return sketch_estimate(sketch->registers, sketch->precision);
+}
+
+
+double
+stringset_sketch_estimate_intersection(
+    struct stringset_sketch const *const *sketches,
+    int count)
+{
+    if (   !sketches_are_compatible(sketches, count)
+        || count > MAX_INTERSECTION_SKETCHES)
+    {
+        errno = EINVAL;
+        return -1.0;
+    }
+    
+    uint8_t *registers = malloc((size_t)1 << sketches[0]->precision);
+    if (!registers) return -1.0;
+    
+    double estimate = 0.0;
+    double min_estimate = -1.0;
+    unsigned subsets_count = 1u << count;
+    for (unsigned subset = 1; subset < subsets_count; ++subset) {
+        double union_estimate = sketch_estimate_subset(sketches,
+                                                       count,
+                                                       subset,
+                                                       registers);
+        if (__builtin_popcount(subset) % 2) {
+            estimate += union_estimate;
+        } else {
+            estimate -= union_estimate;
+        }
+        if (   1 == __builtin_popcount(subset)
+            && (min_estimate < 0.0 || union_estimate < min_estimate))
+        {
+            min_estimate = union_estimate;
+        }
+    }
+    free(registers);
+    
+    if (estimate < 0.0) estimate = 0.0;
+    if (estimate > min_estimate) estimate = min_estimate;
+    return estimate;
+}
+
+
+double
+stringset_sketch_estimate_union(struct stringset_sketch const *const *sketches,
+                                int count)
+{
+    if (!sketches_are_compatible(sketches, count)) {
+        errno = EINVAL;
+        return -1.0;
+    }
+    
+    int precision = sketches[0]->precision;
+    size_t register_count = (size_t)1 << precision;
+    uint8_t *registers = calloc(register_count, 1);
+    if (!registers) return -1.0;
     
-    swap(stringset, intersection);
-    stringset_free(intersection);
+    for (int i = 0; i < count; ++i) {
+        merge_registers(registers, sketches[i]->registers, register_count);
+    }
+    double estimate = sketch_estimate(registers, precision);
+    free(registers);
+    
+    return estimate;
+}
+
+
+void
+stringset_sketch_free(struct stringset_sketch *sketch)
+{
+    free(sketch);
+}
+
+
+int
+stringset_sketch_merge(struct stringset_sketch *sketch,
+                       struct stringset_sketch const *other)
+{
+    if (!sketch || !other || sketch->precision != other->precision) {
+        errno = EINVAL;
+        return -1;
+    }
     
+    merge_registers(sketch->registers,
+                    other->registers,
+                    (size_t)1 << sketch->precision);
     return 0;
 }
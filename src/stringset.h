@@ -3,11 +3,235 @@
 
 
 #include <stdbool.h>
+#include <stddef.h>
 
 
+// Memory allocation functions for a string set.  `allocate', `reallocate' and
+// `deallocate' behave like `malloc()', `realloc()' and `free()' and are passed
+// `context' as their last argument.
+//
+// `reallocate' may be NULL, in which case memory is resized by allocating,
+// copying and deallocating.  `deallocate' may be NULL for arena allocators
+// that release all of their memory at once; string sets then never free
+// individual blocks, and `stringset_clear()' and `stringset_free()' skip the
+// per-member frees entirely.  Release the arena after freeing its sets.
+struct stringset_allocator {
+    void *(*allocate)(size_t size, void *context);
+    void *(*reallocate)(void *memory, size_t size, void *context);
+    void (*deallocate)(void *memory, void *context);
+    void *context;
+};
+
+
+// The order of the members of a string set, chosen when it is allocated.
+//
+// `stringset_order_lexical' is `strcmp()' order.
+//
+// `stringset_order_length_first' orders shorter strings first and strings of
+// the same length with `memcmp()'.  Use it when the order of members doesn't
+// matter: strings of different lengths are ordered without comparing their
+// bytes, which is cheaper for members with long common prefixes.
+//
+// `stringset_order_case_folded' orders strings by `strcmp()' after converting
+// ASCII letters to lowercase, so strings that differ only in the case of ASCII
+// letters are the same member and the spelling of the first one added is
+// kept.
+//
+// Operations on two or more string sets walk their sorted members together,
+// so they require string sets with the same order and set `errno' to `EINVAL'
+// otherwise.
+enum stringset_order {
+    stringset_order_lexical,
+    stringset_order_length_first,
+    stringset_order_case_folded
+};
+
+
+struct stringset_pool;
+
+
+// Options for allocating a string set.  `allocator' may be NULL to use
+// `malloc()', `realloc()' and `free()'.  If `pool' is not NULL, member
+// strings are interned in the pool instead of being copied with `allocator'.
+//
+// If `uses_huge_pages' is true, the members array is mapped with `mmap()'
+// instead of allocated with `allocator', in transparent huge pages once it is
+// large enough, and grows with `mremap()' where available, which moves whole
+// pages instead of copying members.  Use it for very large sets, to reduce
+// TLB misses and the cost of growing.
+//
+// If `uses_explicit_huge_pages' is true, the members array is also mapped,
+// but with `MAP_HUGETLB' from the huge pages reserved in
+// `/proc/sys/vm/nr_hugepages' once it is as large as a huge page, falling
+// back to transparent huge pages when none are left.  Reserved huge pages
+// are never split or swapped, but the array is copied when it grows.
+struct stringset_options {
+    struct stringset_allocator const *allocator;
+    enum stringset_order order;
+    struct stringset_pool *pool;
+    bool uses_huge_pages;
+    bool uses_explicit_huge_pages;
+};
+
+
+// The public string set operations, for counting and timing calls.
+enum stringset_operation {
+    stringset_operation_alloc,
+    stringset_operation_alloc_with_allocator,
+    stringset_operation_alloc_from_array,
+    stringset_operation_alloc_from_stringset,
+    stringset_operation_free,
+    stringset_operation_contains,
+    stringset_operation_is_disjoint_from,
+    stringset_operation_is_equal_to,
+    stringset_operation_is_proper_subset_of,
+    stringset_operation_is_proper_superset_of,
+    stringset_operation_is_subset_of,
+    stringset_operation_is_superset_of,
+    stringset_operation_add,
+    stringset_operation_add_array,
+    stringset_operation_clear,
+    stringset_operation_compact,
+    stringset_operation_remove,
+    stringset_operation_remove_array,
+    stringset_operation_retain_array,
+    stringset_operation_set_deferred,
+    stringset_operation_flush,
+    stringset_operation_alloc_union,
+    stringset_operation_add_stringset,
+    stringset_operation_alloc_intersection,
+    stringset_operation_retain_stringset,
+    stringset_operation_alloc_difference,
+    stringset_operation_remove_stringset,
+    stringset_operation_alloc_symmetric_difference,
+    stringset_operation_add_stringset_remove_common,
+    stringset_operation_alloc_delta,
+    stringset_operation_alloc_delta_from_bytes,
+    stringset_operation_delta_serialize,
+    stringset_operation_apply_delta,
+    stringset_operation_build_filter,
+    stringset_operation_drop_filter,
+    stringset_operation_attach_sketch,
+    stringset_operation_sketch_alloc_from_stringset,
+    stringset_operation_count_union,
+    stringset_operation_count_intersection,
+    stringset_operation_count_difference,
+    stringset_operation_count_symmetric_difference,
+    stringset_operation_jaccard_similarity,
+    stringset_operation_alloc_union_of,
+    stringset_operation_alloc_intersection_of,
+    stringset_operation_alloc_at_least,
+    stringset_operation_alloc_with_options,
+    stringset_operation_build_index,
+    stringset_operation_drop_index,
+    stringset_operation_for_each,
+    stringset_operation_parallel_for_each,
+    stringset_operation_serialize,
+    stringset_operation_alloc_from_bytes,
+    stringset_operation_add_sorted_array,
+    stringset_operation_alloc_from_sorted_array,
+    stringset_operation_count
+};
+
+
+// Counters of the work done by string set operations.  Counting is compiled
+// into the library only when it is built with `STRINGSET_STATS' defined;
+// otherwise the counters are never updated and cost nothing.
+//
+// `calls' counts calls made by the application; operations called internally
+// by other operations aren't counted again.  `comparisons' counts string
+// comparisons, `searches' counts member lookups and `sorts' counts sorts of
+// the members array.  `reallocations', `bytes_allocated' and `bytes_freed'
+// count memory obtained and released through the string set's allocator.
+struct stringset_stats {
+    unsigned long long comparisons;
+    unsigned long long searches;
+    unsigned long long sorts;
+    unsigned long long reallocations;
+    unsigned long long bytes_allocated;
+    unsigned long long bytes_freed;
+    unsigned long long calls[stringset_operation_count];
+};
+
+
+// The number of buckets of a latency histogram.
+#define STRINGSET_HISTOGRAM_BUCKETS 304
+
+// A log-linear histogram of the latencies of calls to an operation, in
+// nanoseconds.  Buckets 0 to 7 count latencies of 0 to 7 nanoseconds; above
+// that, each range from a power of two to the next is split into 8 buckets of
+// equal width, so a bucket's width is at most 1/8 of the latencies it counts.
+// Latencies of 2^40 nanoseconds, about 18 minutes, or more are counted in
+// the last bucket.
+struct stringset_histogram {
+    unsigned long long counts[STRINGSET_HISTOGRAM_BUCKETS];
+};
+
+// A call to a public operation, passed to trace hooks.  `count' and
+// `other_count' are the number of members of the string set the operation
+// was called on and of the second string set of operations on two string
+// sets, when the operation began, or -1 if there is no such string set.
+// `nanoseconds' is the latency of the call, or 0 when it began.
+struct stringset_trace_event {
+    enum stringset_operation operation;
+    long long count;
+    long long other_count;
+    unsigned long long nanoseconds;
+};
+
+// A function called when a public operation begins or ends.  `context' is the
+// context passed to `stringset_set_trace_hooks()'.
+typedef void
+(*stringset_trace_hook)(struct stringset_trace_event const *event,
+                        void *context);
+
+
+struct stringset_filter;
+struct stringset_index;
+struct stringset_sketch;
+struct stringset_slab;
+
+
+// A cursor visits the members of a string set in its order, or in reverse
+// order.  The fields are private.
+struct stringset_cursor {
+    struct stringset const *stringset;
+    size_t index;
+    bool is_reverse;
+};
+
+// A function called for each member visited by `stringset_for_each()' and
+// `stringset_parallel_for_each()'.  `context' is the context passed to them.
+// Return 0 to continue visiting members or any other value to stop.
+typedef int
+(*stringset_visitor)(char const *member, void *context);
+
+
+// A string set.  `members' holds `count' strings sorted in the string set's
+// `order', except that a deferred string set with pending members must be
+// flushed by calling `stringset_flush()' before `members' is read directly.
+// Adding members past `SIZE_MAX / 2 / sizeof(char *)' fails with
+// `EOVERFLOW'.  The remaining fields are private.
 struct stringset {
     char **members;
-    int count;
+    size_t count;
+    
+    struct stringset_allocator allocator;
+    struct stringset_stats *stats;
+    size_t capacity;
+    char **pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    bool is_deferred;
+    struct stringset_filter *filter;
+    struct stringset_index *index;
+    struct stringset_sketch *sketch;
+    enum stringset_order order;
+    struct stringset_pool *pool;
+    size_t *share_count;
+    bool uses_huge_pages;
+    bool uses_explicit_huge_pages;
+    struct stringset_slab *slab;
 };
 
 
@@ -19,13 +243,44 @@ struct stringset {
 struct stringset *
 stringset_alloc(void);
 
+// Allocate an empty string set that gets all of its memory from `allocator':
+// the string set itself, its members array and its member strings.  The
+// allocator is copied.  If `allocator' is NULL, `malloc()', `realloc()' and
+// `free()' are used.  String sets allocated by the set operations below use
+// the allocator of their first operand.
+struct stringset *
+stringset_alloc_with_allocator(struct stringset_allocator const *allocator);
+
+// Allocate an empty string set with the given allocator and member order.
+// If `options' is NULL, the defaults of `stringset_alloc()' are used: the
+// standard allocator and `stringset_order_lexical'.  String sets allocated by
+// the set operations below have the order of their first operand.
+struct stringset *
+stringset_alloc_with_options(struct stringset_options const *options);
+
 // Allocate a string set from an array.  Strings in the array are copied when
-// added to the resulting string set.
+// added to the resulting string set.  An array that is already sorted, or is
+// made of a few sorted runs, is added in linear time; see
+// `stringset_add_array()'.
 struct stringset *
-stringset_alloc_from_array(char const *const *array, int count);
+stringset_alloc_from_array(char const *const *array, size_t count);
 
-// Allocate a string set from a string set.  Strings in the string set are
-// copied when added to the resulting string set.
+// Allocate a string set from an array sorted in lexical order with no
+// duplicates, such as the members of another string set, by copying the
+// strings in one pass.  Sets `errno' to `EINVAL' if the array isn't sorted
+// and unique.
+struct stringset *
+stringset_alloc_from_sorted_array(char const *const *array, size_t count);
+
+// Allocate a clone of a string set in constant time.  The clone shares the
+// members array and member strings of `stringset' until either string set is
+// modified, which then copies the array of pointers but still shares the
+// strings by reference counting.  The shared counts are atomic, so a string
+// set and its clones may be modified and freed on different threads, such as
+// a snapshot taken for each request while the original keeps changing,
+// unless they use an interning pool.  Like the other functions that read a
+// string set, this may be called on several threads at once for the same
+// string set unless it is deferred.
 struct stringset *
 stringset_alloc_from_stringset(struct stringset const *stringset);
 
@@ -34,6 +289,37 @@ void
 stringset_free(struct stringset *stringset);
 
 
+/*******************
+ * Interning pools *
+ *******************/
+
+// An interning pool holds a single reference counted copy of each distinct
+// string that is a member of the string sets allocated with it, so sets that
+// share a vocabulary don't each copy its strings.  Members of these sets are
+// pointers into the pool: copying a member between sets with the same pool
+// copies the pointer and adds a reference, and identical members of these
+// sets are equal pointers, which `stringset_is_equal_to()' and the merging
+// set operations compare before comparing bytes.  A string is freed when the
+// last member that refers to it is removed.
+//
+// A pool and the string sets allocated with it must not be modified
+// concurrently.
+struct stringset_pool;
+
+// Allocate an empty interning pool.
+struct stringset_pool *
+stringset_pool_alloc(void);
+
+// Free an interning pool.  Free the string sets allocated with the pool
+// first.
+void
+stringset_pool_free(struct stringset_pool *pool);
+
+// The number of distinct strings in an interning pool.
+size_t
+stringset_pool_count(struct stringset_pool const *pool);
+
+
 /*******************
  * Test membership *
  *******************/
@@ -74,6 +360,51 @@ stringset_is_superset_of(struct stringset const *stringset,
                          struct stringset const *other);
 
 
+/*************
+ * Iteration *
+ *************/
+
+// These functions visit members without reading `members' directly, so they
+// work for every kind of string set, including deferred string sets with
+// pending members.  Each prefetches the strings of the members it visits
+// next.  The string set must not be modified while its members are visited.
+
+// Start a cursor before the first member of a string set, or after the last
+// member if `is_reverse' is true.
+void
+stringset_cursor_init(struct stringset_cursor *cursor,
+                      struct stringset const *stringset,
+                      bool is_reverse);
+
+// Move a cursor to the next member and return it, or return NULL once every
+// member has been visited.
+char const *
+stringset_cursor_next(struct stringset_cursor *cursor);
+
+// Call `visitor' for each member of a string set in order.  Returns 0 once
+// every member has been visited, the value `visitor' returned if it stopped,
+// or -1 on error.
+int
+stringset_for_each(struct stringset const *stringset,
+                   stringset_visitor visitor,
+                   void *context);
+
+// Call `visitor' for each member of a string set on `threads_count' threads,
+// including the calling thread, for expensive work on each member.  The
+// threads take turns claiming consecutive runs of members, which each visits
+// in order; `visitor' must be thread safe.  If it returns a value other than
+// 0, the threads stop claiming members and one of the values is returned
+// once they all have.  Otherwise, returns 0 once every member has been
+// visited, or -1 on error.  Fewer threads are used if they can't be created.
+// The other threads are started on first use and kept idle between calls for
+// the life of the process, so repeated calls reuse them.
+int
+stringset_parallel_for_each(struct stringset const *stringset,
+                            int threads_count,
+                            stringset_visitor visitor,
+                            void *context);
+
+
 /*****************************
  * Insert and delete members *
  *****************************/
@@ -86,10 +417,23 @@ stringset_add(struct stringset *stringset, char const *string);
 // Add an array of strings to a string set.  Each string that is not a member
 // is copied and added to the string set.  The resulting `stringset' is the
 // union of the original `stringset' with the string set formed by the array.
+//
+// The array is sorted and merged with the members in one pass.  Sorting
+// finds the natural runs of the array first: an array that is already
+// sorted, forward or backward, costs one comparison per string, and an array
+// made of a few sorted runs is sorted by merging them.
 int
 stringset_add_array(struct stringset *stringset,
                     char const *const *array,
-                    int count);
+                    size_t count);
+
+// Add an array of strings sorted in the string set's order with no
+// duplicates, skipping the sort.  Sets `errno' to `EINVAL' if the array isn't
+// sorted and unique.
+int
+stringset_add_sorted_array(struct stringset *stringset,
+                           char const *const *array,
+                           size_t count);
 
 // Remove all members from a string set and compact it.
 int
@@ -113,7 +457,7 @@ stringset_remove(struct stringset *stringset, char const *string);
 int
 stringset_remove_array(struct stringset *stringset,
                        char const *const *array,
-                       int count);
+                       size_t count);
 
 // Retain only the members of a string set that are present in an array of
 // strings.  The resulting `stringset' is the intersection of the original
@@ -121,7 +465,145 @@ stringset_remove_array(struct stringset *stringset,
 int
 stringset_retain_array(struct stringset *stringset,
                        char const *const *array,
-                       int count);
+                       size_t count);
+
+
+/**********************
+ * Deferred insertion *
+ **********************/
+
+// Enable or disable deferred insertion for a string set.  A deferred string
+// set appends new members to a pending buffer with its own small hash index
+// instead of sorting them into `members' on every add.  Pending members are
+// sorted and merged into `members' when the buffer grows past a fraction of
+// the set size, when `stringset_flush()' is called, and before any operation
+// other than `stringset_add()' and `stringset_contains()' reads the members.
+// Disabling deferred insertion flushes the string set.
+//
+// Because pending members may be merged by functions that take a `const'
+// string set, a deferred string set must not be read concurrently.
+int
+stringset_set_deferred(struct stringset *stringset, bool is_deferred);
+
+// Sort and merge any pending members of a deferred string set into
+// `members'.  Call this before reading `members' directly.
+int
+stringset_flush(struct stringset *stringset);
+
+
+/***********
+ * Filters *
+ ***********/
+
+// Build a blocked Bloom filter over the members of a string set with the
+// given false positive rate, between 0 and 1.  `stringset_contains()' checks
+// the filter first, so most lookups of strings that aren't members return
+// without searching the members.  The filter is updated by
+// `stringset_add()' and rebuilt as the set grows, by `stringset_compact()'
+// after members are removed, and after operations that replace the members.
+// Removed members may still pass the filter until it is rebuilt, which only
+// costs a search.  Building a filter on a set that has one replaces it.
+int
+stringset_build_filter(struct stringset *stringset,
+                       double false_positive_rate);
+
+// Remove the filter of a string set and free its memory.
+int
+stringset_drop_filter(struct stringset *stringset);
+
+
+/******************
+ * Search indexes *
+ ******************/
+
+// Build a read-optimized search index over the members of a string set.  The
+// index lays the members out in Eytzinger (breadth-first) order with the
+// first bytes of each member stored inline, so `stringset_contains()' and the
+// `stringset_is_*()' predicates touch fewer cache lines than a binary search
+// of `members' and prefetch the lines the search reaches next.  `members'
+// stays sorted.  Any change to the members drops the index, so build it once
+// a set is read-mostly.  Building an index on a set that has one replaces it.
+int
+stringset_build_index(struct stringset *stringset);
+
+// Remove the search index of a string set and free its memory.
+int
+stringset_drop_index(struct stringset *stringset);
+
+
+/************************
+ * Cardinality sketches *
+ ************************/
+
+// A HyperLogLog sketch estimates the number of distinct strings added to it
+// in a fixed amount of memory, one byte for each of its 2^`precision'
+// registers.  Sketches of the same precision can be merged, so the sizes of
+// unions and intersections of string sets can be estimated without copying
+// any strings.
+//
+// The relative standard error of an estimate is about 1.04 / sqrt(2^
+// `precision'): 1.6% for precision 12 (4 KB) and 0.8% for precision 14
+// (16 KB).  Estimates are within twice that error about 95% of the time.
+// Intersection estimates are derived from union estimates, so their error is
+// relative to the size of the union, not the intersection; they are useful
+// only when the intersection is a sizable fraction of the union.
+struct stringset_sketch;
+
+// Allocate an empty sketch with 2^`precision' registers.  `precision' must be
+// between 4 and 18.
+struct stringset_sketch *
+stringset_sketch_alloc(int precision);
+
+// Allocate a sketch of the members of a string set.
+struct stringset_sketch *
+stringset_sketch_alloc_from_stringset(struct stringset const *stringset,
+                                      int precision);
+
+// Free an allocated sketch.  Detach it from any string set first.
+void
+stringset_sketch_free(struct stringset_sketch *sketch);
+
+// Add a string to a sketch.  Adding a string more than once has no effect.
+int
+stringset_sketch_add(struct stringset_sketch *sketch, char const *string);
+
+// Merge another sketch into a sketch.  The resulting `sketch' estimates the
+// union of the strings added to both.  The sketches must have the same
+// precision.
+int
+stringset_sketch_merge(struct stringset_sketch *sketch,
+                       struct stringset_sketch const *other);
+
+// Estimate the number of distinct strings added to a sketch.
+double
+stringset_sketch_estimate(struct stringset_sketch const *sketch);
+
+// Estimate the size of the union of the string sets summarized by an array of
+// sketches of the same precision, without modifying them.  Returns -1 and
+// sets `errno' to `EINVAL' if the sketches can't be combined.
+double
+stringset_sketch_estimate_union(struct stringset_sketch const *const *sketches,
+                                int count);
+
+// Estimate the size of the intersection of the string sets summarized by an
+// array of up to 8 sketches of the same precision by inclusion-exclusion over
+// the unions of every subset of the sketches.  The error grows quickly with
+// the number of sketches.  Returns -1 and sets `errno' to `EINVAL' if the
+// sketches can't be combined.
+double
+stringset_sketch_estimate_intersection(
+    struct stringset_sketch const *const *sketches,
+    int count);
+
+// Attach a sketch to a string set.  The sketch is updated with the current
+// members and then with each member added to the string set until it is
+// detached by attaching NULL.  The string set doesn't own the sketch.  A
+// sketch can't forget strings, so members removed from the string set are
+// still counted; allocate a new sketch after removing many members.  Members
+// of string sets with `stringset_order_case_folded' are counted in lowercase.
+int
+stringset_attach_sketch(struct stringset *stringset,
+                        struct stringset_sketch *sketch);
 
 
 /********************
@@ -140,6 +622,20 @@ int
 stringset_add_stringset(struct stringset *stringset,
                         struct stringset const *other);
 
+// Allocate a string set that is the union of an array of `count' string
+// sets.  The string sets are merged in one pass with a heap of cursors into
+// their sorted members.
+struct stringset *
+stringset_alloc_union_of(struct stringset const *const *stringsets,
+                         int count);
+
+// Count the members of the union of two string sets without allocating it.
+// Like the other `stringset_count_*()' functions, returns 0 and sets `errno'
+// to `EINVAL' if the string sets can't be combined.
+size_t
+stringset_count_union(struct stringset const *first,
+                      struct stringset const *second);
+
 
 /***************************
  * Intersection operations *
@@ -159,6 +655,36 @@ int
 stringset_retain_stringset(struct stringset *stringset,
                            struct stringset const *other);
 
+// Allocate a string set that is the intersection of an array of `count'
+// string sets.  Each member of the smallest string set is searched for in
+// the others from smallest to largest by galloping forward from the previous
+// match, so the cost is proportional to the size of the smallest set.
+struct stringset *
+stringset_alloc_intersection_of(struct stringset const *const *stringsets,
+                                int count);
+
+// Allocate a string set of the strings that are members of at least
+// `min_count' of an array of `count' string sets.  A `min_count' of 1 is the
+// union and a `min_count' of `count' is the intersection.
+struct stringset *
+stringset_alloc_at_least(struct stringset const *const *stringsets,
+                         int count,
+                         int min_count);
+
+// Count the members of the intersection of two string sets without
+// allocating it.
+size_t
+stringset_count_intersection(struct stringset const *first,
+                             struct stringset const *second);
+
+// The Jaccard similarity of two string sets: the size of their intersection
+// divided by the size of their union, from 0 for disjoint sets to 1 for equal
+// sets.  Two empty sets have a similarity of 1.  Returns -1 and sets `errno'
+// to `EINVAL' if either string set is NULL.
+double
+stringset_jaccard_similarity(struct stringset const *first,
+                             struct stringset const *second);
+
 
 /*************************
  * Difference operations *
@@ -177,6 +703,12 @@ int
 stringset_remove_stringset(struct stringset *stringset,
                            struct stringset const *other);
 
+// Count the members of `first' that are not members of `second' without
+// allocating their difference.
+size_t
+stringset_count_difference(struct stringset const *first,
+                           struct stringset const *second);
+
 
 /***********************************
  * Symmetric difference operations *
@@ -196,5 +728,135 @@ int
 stringset_add_stringset_remove_common(struct stringset *stringset,
                                       struct stringset const *other);
 
+// Count the members of the symmetric difference of two string sets without
+// allocating it.
+size_t
+stringset_count_symmetric_difference(struct stringset const *first,
+                                     struct stringset const *second);
+
+
+/*****************
+ * Serialization *
+ *****************/
+
+// Serialize a string set into a compact form for storage or transfer: a
+// header and the order of its members, the members front coded with varint
+// lengths, and a CRC-32 of the preceding bytes.  Returns a buffer allocated
+// with `malloc()' and sets `size' to its length.
+void *
+stringset_serialize(struct stringset const *stringset, size_t *size);
+
+// Allocate a string set from bytes produced by `stringset_serialize()'.  The
+// members are already sorted, so they are appended in one pass into a members
+// array allocated once.  Sets `errno' to `EINVAL' if the bytes are not a
+// valid serialized string set or fail the checksum.
+struct stringset *
+stringset_alloc_from_bytes(void const *bytes, size_t size);
+
+
+/**********
+ * Deltas *
+ **********/
+
+// The changes between two versions of a string set: the members that were
+// added and the members that were removed.
+struct stringset_delta {
+    struct stringset *added;
+    struct stringset *removed;
+};
+
+// Allocate the delta that changes string set `from' into string set `to'.
+// The delta is computed in one merge pass over the sorted members.
+struct stringset_delta *
+stringset_alloc_delta(struct stringset const *from,
+                      struct stringset const *to);
+
+// Allocate a delta from bytes produced by `stringset_delta_serialize()'.
+// Sets `errno' to `EINVAL' if the bytes are not a valid serialized delta.
+struct stringset_delta *
+stringset_alloc_delta_from_bytes(void const *bytes, size_t size);
+
+// Delete all members and free an allocated delta.
+void
+stringset_delta_free(struct stringset_delta *delta);
+
+// Serialize a delta into a compact form: a header and the order of the
+// delta's members followed by the added and removed members, each list front
+// coded with varint lengths.  Returns a
+// buffer allocated with `malloc()' and sets `size' to its length.
+void *
+stringset_delta_serialize(struct stringset_delta const *delta, size_t *size);
+
+// Apply a delta to a string set: add the delta's added members and remove its
+// removed members.  The members array is rebuilt in a single compaction pass.
+int
+stringset_apply_delta(struct stringset *stringset,
+                      struct stringset_delta const *delta);
+
+
+/**************
+ * Statistics *
+ **************/
+
+// Attach a stats block to a string set.  The work done by operations on the
+// string set is added to `stats' as well as to the global stats.  Several
+// string sets may share a stats block.  Pass NULL to detach the stats block.
+// Counters are updated with relaxed atomic additions.
+int
+stringset_set_stats(struct stringset *stringset,
+                    struct stringset_stats *stats);
+
+// Copy the global stats, which count the work done by all string sets.
+void
+stringset_get_global_stats(struct stringset_stats *stats);
+
+// Set all global counters to zero.
+void
+stringset_reset_global_stats(void);
+
+// Set all counters of a stats block to zero.
+void
+stringset_reset_stats(struct stringset_stats *stats);
+
+// The name of an operation, such as "add" or "alloc_union".
+char const *
+stringset_operation_name(enum stringset_operation operation);
+
+
+/***********
+ * Tracing *
+ ***********/
+
+// Tracing is compiled into the library only when it is built with
+// `STRINGSET_TRACE' defined; otherwise operations are never timed, the
+// histograms stay empty and the hooks are never called.  Only operations
+// called by the application are traced, not operations they call internally
+// or operations called by the hooks.
+
+// Copy the latency histogram of an operation, which counts the calls to it
+// by all threads.
+int
+stringset_get_histogram(enum stringset_operation operation,
+                        struct stringset_histogram *histogram);
+
+// Set the latency histograms of all operations to zero.
+void
+stringset_reset_histograms(void);
+
+// The latency in nanoseconds that a fraction `quantile' of the calls counted
+// by a histogram took at most, such as 0.99 for the 99th percentile, rounded
+// up to the end of its bucket.  Returns 0 for an empty histogram.
+unsigned long long
+stringset_histogram_quantile(struct stringset_histogram const *histogram,
+                             double quantile);
+
+// Set the functions called with `context' when an operation begins and ends
+// on any thread.  Either may be NULL.  Set the hooks before other threads
+// call string set functions; the hooks must be thread safe.
+void
+stringset_set_trace_hooks(stringset_trace_hook begin,
+                          stringset_trace_hook end,
+                          void *context);
+
 
 #endif
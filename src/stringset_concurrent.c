@@ -0,0 +1,409 @@
+#include "stringset_concurrent.h"
+#include "stringset_hash.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// The smallest number of slots of a table.
+#define MIN_CAPACITY 64
+
+// Tables are migrated in chunks of this many slots, claimed by the threads
+// helping with the migration.
+#define MIGRATION_CHUNK_SLOTS 1024
+
+// The low bit of a slot is set once the slot has been migrated to the next
+// table.  A migrated empty slot holds only this bit.
+#define MOVED ((uintptr_t)1)
+
+
+struct entry {
+    uint64_t hash;
+    char bytes[];
+};
+
+
+// A hash table with linear probing.  Each slot holds 0, a pointer to an
+// entry, or either of those with the `MOVED' bit set.  Slots only ever
+// change from 0 to an entry and then to moved, so an entry stays in its slot
+// until the table is freed.  `next' is the larger table members are
+// migrated to once the table is too full.
+struct table {
+    struct table *next;
+    size_t capacity;
+    size_t count;
+    size_t claimed_chunks_count;
+    size_t migrated_chunks_count;
+    uintptr_t slots[];
+};
+
+
+// `table' is the newest table whose migration has finished, which new
+// operations start from.  `first' is the oldest table.
+struct stringset_concurrent {
+    struct table *table;
+    struct table *first;
+    size_t count;
+};
+
+
+// Members are compared with `strcmp()', so they are hashed as members of a
+// lexical string set.
+static uint64_t
+hash_entry(char const *string)
+{
+    return mix_hash(hash_string(stringset_order_lexical, string));
+}
+
+
+static bool
+is_entry_of(uintptr_t slot, uint64_t hash, char const *string)
+{
+    struct entry const *entry = (struct entry const *)(slot & ~MOVED);
+    return entry && entry->hash == hash && 0 == strcmp(entry->bytes, string);
+}
+
+
+static struct table *
+alloc_table(size_t capacity)
+{
+    if (capacity > (SIZE_MAX - sizeof(struct table)) / sizeof(uintptr_t)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    struct table *table = calloc(1, sizeof(struct table)
+                                    + sizeof(uintptr_t) * capacity);
+    if (!table) return NULL;
+    
+    table->capacity = capacity;
+    return table;
+}
+
+
+// Allocate the next table of `table' unless another thread already has.
+static int
+start_migration(struct table *table)
+{
+    if (__atomic_load_n(&table->next, __ATOMIC_ACQUIRE)) return 0;
+    if (table->capacity > SIZE_MAX / 2) {
+        errno = ENOMEM;
+        return -1;
+    }
+    
+    struct table *next = alloc_table(2 * table->capacity);
+    if (!next) return -1;
+    
+    struct table *expected = NULL;
+    if (!__atomic_compare_exchange_n(&table->next,
+                                     &expected,
+                                     next,
+                                     false,
+                                     __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE))
+    {
+        free(next);
+    }
+    return 0;
+}
+
+
+static int
+migrate(struct stringset_concurrent *concurrent, struct table *table);
+
+
+// Add an entry to `table' or the tables it is being migrated to, unless an
+// equal entry is already there.  Returns 1 if the entry was added, 0 if an
+// equal entry was found or -1 on error.
+static int
+insert(struct stringset_concurrent *concurrent,
+       struct table *table,
+       struct entry *entry)
+{
+    while (true) {
+        struct table *next = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+        if (next) {
+            if (-1 == migrate(concurrent, table)) return -1;
+            table = next;
+            continue;
+        }
+        
+        size_t mask = table->capacity - 1;
+        size_t index = entry->hash & mask;
+        for (size_t i = 0; i < table->capacity; ++i) {
+            uintptr_t *slot = &table->slots[index];
+            uintptr_t value = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+            if (   !value
+                && __atomic_compare_exchange_n(slot,
+                                               &value,
+                                               (uintptr_t)entry,
+                                               false,
+                                               __ATOMIC_ACQ_REL,
+                                               __ATOMIC_ACQUIRE))
+            {
+                size_t count = __atomic_add_fetch(&table->count,
+                                                  1,
+                                                  __ATOMIC_RELAXED);
+                // Growing here is only an early start; a failure is retried
+                // when the table is full.
+                if (   count > table->capacity / 4 * 3
+                    && 0 == start_migration(table))
+                {
+                    migrate(concurrent, table);
+                }
+                return 1;
+            }
+            if (MOVED == value) break;
+            if (is_entry_of(value, entry->hash, entry->bytes)) return 0;
+            index = (index + 1) & mask;
+        }
+        
+        // The table is being migrated or is full.
+        if (-1 == start_migration(table)) return -1;
+    }
+}
+
+
+// Copy the entry in a slot to the next table, if there is one, and mark the
+// slot moved.  Any number of threads may migrate the same slot.
+static int
+migrate_slot(struct stringset_concurrent *concurrent,
+             struct table *table,
+             uintptr_t *slot)
+{
+    struct table *next = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+    uintptr_t value = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+    while (!(value & MOVED)) {
+        if (value) {
+            int result = insert(concurrent, next, (struct entry *)value);
+            if (-1 == result) return -1;
+        }
+        __atomic_compare_exchange_n(slot,
+                                    &value,
+                                    value | MOVED,
+                                    false,
+                                    __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE);
+    }
+    return 0;
+}
+
+
+// Help migrate `table' to its next table and return once every slot has
+// been migrated, by this thread or others.
+static int
+migrate(struct stringset_concurrent *concurrent, struct table *table)
+{
+    size_t chunks_count = (table->capacity + MIGRATION_CHUNK_SLOTS - 1)
+                        / MIGRATION_CHUNK_SLOTS;
+    while (true) {
+        size_t chunk = __atomic_fetch_add(&table->claimed_chunks_count,
+                                          1,
+                                          __ATOMIC_RELAXED);
+        if (chunk >= chunks_count) break;
+        
+        size_t start = chunk * MIGRATION_CHUNK_SLOTS;
+        size_t end = start + MIGRATION_CHUNK_SLOTS;
+        if (end > table->capacity) end = table->capacity;
+        for (size_t i = start; i < end; ++i) {
+            int result = migrate_slot(concurrent, table, &table->slots[i]);
+            if (-1 == result) return -1;
+        }
+        __atomic_add_fetch(&table->migrated_chunks_count,
+                           1,
+                           __ATOMIC_RELEASE);
+    }
+    
+    // Rather than wait for the threads still migrating the chunks they
+    // claimed, or that failed to, migrate any slots they haven't yet.
+    size_t migrated_chunks_count = __atomic_load_n(
+        &table->migrated_chunks_count,
+        __ATOMIC_ACQUIRE);
+    if (migrated_chunks_count < chunks_count) {
+        for (size_t i = 0; i < table->capacity; ++i) {
+            int result = migrate_slot(concurrent, table, &table->slots[i]);
+            if (-1 == result) return -1;
+        }
+    }
+    
+    struct table *next = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+    struct table *expected = table;
+    __atomic_compare_exchange_n(&concurrent->table,
+                                &expected,
+                                next,
+                                false,
+                                __ATOMIC_ACQ_REL,
+                                __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+
+struct stringset_concurrent *
+stringset_concurrent_alloc(size_t expected_count)
+{
+    size_t capacity = MIN_CAPACITY;
+    while (capacity / 4 * 3 < expected_count) {
+        if (capacity > SIZE_MAX / 2) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        capacity *= 2;
+    }
+    
+    struct stringset_concurrent *concurrent = calloc(
+        1,
+        sizeof(struct stringset_concurrent));
+    if (!concurrent) return NULL;
+    
+    concurrent->table = alloc_table(capacity);
+    if (!concurrent->table) {
+        free(concurrent);
+        return NULL;
+    }
+    concurrent->first = concurrent->table;
+    return concurrent;
+}
+
+
+struct stringset *
+stringset_concurrent_alloc_stringset(
+    struct stringset_concurrent const *concurrent,
+    struct stringset_options const *options)
+{
+    if (!concurrent) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    size_t count = stringset_concurrent_count(concurrent);
+    if (count > SIZE_MAX / sizeof(char *)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    char const **strings = malloc(sizeof(char *) * (count ? count : 1));
+    if (!strings) return NULL;
+    
+    // Each member is in exactly one slot without the moved bit, in the
+    // newest table it has been migrated to.
+    size_t strings_count = 0;
+    for (struct table *table = concurrent->first;
+         table && strings_count < count;
+         table = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE))
+    {
+        for (size_t i = 0; i < table->capacity; ++i) {
+            uintptr_t value = __atomic_load_n(&table->slots[i],
+                                              __ATOMIC_ACQUIRE);
+            if (value && !(value & MOVED) && strings_count < count) {
+                strings[strings_count++] = ((struct entry *)value)->bytes;
+            }
+        }
+    }
+    
+    struct stringset *stringset = stringset_alloc_with_options(options);
+    int result = stringset ? stringset_set_deferred(stringset, true) : -1;
+    if (0 == result) {
+        result = stringset_add_array(stringset, strings, strings_count);
+    }
+    if (0 == result) result = stringset_set_deferred(stringset, false);
+    free(strings);
+    if (-1 == result) {
+        stringset_free(stringset);
+        return NULL;
+    }
+    return stringset;
+}
+
+
+void
+stringset_concurrent_free(struct stringset_concurrent *concurrent)
+{
+    if (concurrent) {
+        struct table *table = concurrent->first;
+        while (table) {
+            for (size_t i = 0; i < table->capacity; ++i) {
+                uintptr_t value = table->slots[i];
+                if (!(value & MOVED)) free((struct entry *)value);
+            }
+            struct table *next = table->next;
+            free(table);
+            table = next;
+        }
+        free(concurrent);
+    }
+}
+
+
+int
+stringset_concurrent_add(struct stringset_concurrent *concurrent,
+                         char const *string)
+{
+    if (!concurrent || !string) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    // Most strings added while deduplicating are already members, so look
+    // for the string before copying it.
+    if (stringset_concurrent_contains(concurrent, string)) return 0;
+    
+    size_t size = strlen(string) + 1;
+    struct entry *entry = malloc(sizeof(struct entry) + size);
+    if (!entry) return -1;
+    entry->hash = hash_entry(string);
+    memcpy(entry->bytes, string, size);
+    
+    struct table *table = __atomic_load_n(&concurrent->table,
+                                          __ATOMIC_ACQUIRE);
+    int result = insert(concurrent, table, entry);
+    if (1 == result) {
+        __atomic_add_fetch(&concurrent->count, 1, __ATOMIC_RELAXED);
+    } else {
+        free(entry);
+    }
+    return result;
+}
+
+
+bool
+stringset_concurrent_contains(struct stringset_concurrent const *concurrent,
+                              char const *string)
+{
+    if (!concurrent || !string) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    uint64_t hash = hash_entry(string);
+    struct table *table = __atomic_load_n(&concurrent->table,
+                                          __ATOMIC_ACQUIRE);
+    while (table) {
+        size_t mask = table->capacity - 1;
+        size_t index = hash & mask;
+        for (size_t i = 0; i < table->capacity; ++i) {
+            uintptr_t value = __atomic_load_n(&table->slots[index],
+                                              __ATOMIC_ACQUIRE);
+            if (!value) return false;
+            if (MOVED == value) break;
+            if (is_entry_of(value, hash, string)) return true;
+            index = (index + 1) & mask;
+        }
+        
+        // A moved empty slot means the string can only have been added
+        // after the table was migrated.
+        table = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+    }
+    return false;
+}
+
+
+size_t
+stringset_concurrent_count(struct stringset_concurrent const *concurrent)
+{
+    if (!concurrent) {
+        errno = EINVAL;
+        return 0;
+    }
+    
+    return __atomic_load_n(&concurrent->count, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,76 @@
+#ifndef STRINGSET_CONCURRENT_H_INCLUDED
+#define STRINGSET_CONCURRENT_H_INCLUDED
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "stringset.h"
+
+
+// A concurrent string set is a lock-free hash set of strings for
+// deduplicating strings on many threads at once.  Members can be added and
+// tested but not removed.  Adding a string is lock-free and testing one is
+// wait-free: no thread ever waits for another to release a lock.
+//
+// The hash table grows by allocating a table twice as large and migrating
+// members to it.  Threads that find a migration in progress help with it
+// before adding their own strings.  Outgrown tables are kept until the set is
+// freed so that threads still reading them never see freed memory, which
+// costs at most as much memory again as the newest table.
+//
+// Members are compared with `strcmp()'.
+struct stringset_concurrent;
+
+
+/****************************
+ * Creation and destruction *
+ ****************************/
+
+// Allocate an empty concurrent string set with room for about
+// `expected_count' members before its table grows.
+struct stringset_concurrent *
+stringset_concurrent_alloc(size_t expected_count);
+
+// Allocate a string set with the members of a concurrent string set, sorted
+// in the order given by `options', which may be NULL for the defaults.  Call
+// it once no thread is adding strings; members added during the call may or
+// may not be included.
+struct stringset *
+stringset_concurrent_alloc_stringset(
+    struct stringset_concurrent const *concurrent,
+    struct stringset_options const *options);
+
+// Delete all members and free an allocated concurrent string set.  No other
+// thread may use it.
+void
+stringset_concurrent_free(struct stringset_concurrent *concurrent);
+
+
+/*******************
+ * Test membership *
+ *******************/
+
+// The number of members of a concurrent string set.
+size_t
+stringset_concurrent_count(struct stringset_concurrent const *concurrent);
+
+bool
+stringset_concurrent_contains(struct stringset_concurrent const *concurrent,
+                              char const *string);
+
+
+/***************
+ * Add members *
+ ***************/
+
+// Add a string to a concurrent string set if it isn't a member.  The string
+// is copied.  Returns 1 if the string was added, 0 if it was already a
+// member, or -1 on error.  When several threads add the same string at once,
+// exactly one of them gets 1.
+int
+stringset_concurrent_add(struct stringset_concurrent *concurrent,
+                         char const *string);
+
+
+#endif
@@ -0,0 +1,719 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "stringset_external.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+// Runs are merged in tiers.  A spilled run is in tier 0, and once the newest
+// `MERGE_FANOUT' runs are in the same tier they are merged into one run of
+// the next tier.  Each string is then written once per tier, about
+// log(n / budget) / log(MERGE_FANOUT) times for n bytes of strings, and at
+// most `MERGE_FANOUT' - 1 runs of each tier stay open.
+#define MERGE_FANOUT 16
+
+
+struct stringset_external {
+    char **buffer;
+    size_t buffer_count;
+    size_t buffer_capacity;
+    size_t buffer_size;
+    size_t memory_budget;
+    char *directory;
+    FILE **runs;
+    size_t *run_tiers;
+    size_t run_count;
+};
+
+
+// A sorted, deduplicated sequence of strings read either from a run file or
+// from the in-memory buffer.
+struct source {
+    FILE *run;
+    char *record;
+    size_t record_capacity;
+    char **strings;
+    size_t strings_count;
+    size_t index;
+    char const *current;
+};
+
+
+// A k-way merge of sources that yields each distinct string once.
+struct merge {
+    struct source *sources;
+    size_t source_count;
+    struct source **heap;
+    size_t heap_count;
+    char *last;
+    size_t last_capacity;
+    bool has_last;
+};
+
+
+enum operation {
+    operation_union,
+    operation_intersection,
+    operation_difference,
+};
+
+
+static int
+compare_strings(void const *first, void const *second)
+{
+    char *const *first_string = first;
+    char *const *second_string = second;
+    return strcmp(*first_string, *second_string);
+}
+
+
+static int
+ensure_capacity(char **buffer, size_t *capacity, size_t size)
+{
+    if (size <= *capacity) return 0;
+    
+    size_t new_capacity = *capacity ? *capacity : 64;
+    while (new_capacity < size) new_capacity *= 2;
+    char *new_buffer = realloc(*buffer, new_capacity);
+    if (!new_buffer) return -1;
+    
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 0;
+}
+
+
+static FILE *
+open_run(struct stringset_external const *external)
+{
+    if (!external->directory) return tmpfile();
+    
+    size_t path_size = strlen(external->directory) + sizeof "/stringset.XXXXXX";
+    char *path = malloc(path_size);
+    if (!path) return NULL;
+    snprintf(path, path_size, "%s/stringset.XXXXXX", external->directory);
+    
+    int fd = mkstemp(path);
+    if (-1 == fd) {
+        free(path);
+        return NULL;
+    }
+    unlink(path);
+    free(path);
+    
+    FILE *run = fdopen(fd, "w+b");
+    if (!run) close(fd);
+    return run;
+}
+
+
+// Read a varint length prefix.  Returns 1 on success, 0 at end of file and
+// -1 on error.
+static int
+read_length(FILE *run, size_t *length)
+{
+    *length = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = getc(run);
+        if (EOF == byte) {
+            if (ferror(run)) return -1;
+            if (shift) {
+                errno = EIO;
+                return -1;
+            }
+            return 0;
+        }
+        *length |= (size_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return 1;
+    }
+    errno = EIO;
+    return -1;
+}
+
+
+static int
+write_length(FILE *run, size_t length)
+{
+    do {
+        int byte = length & 0x7f;
+        length >>= 7;
+        if (length) byte |= 0x80;
+        if (EOF == putc(byte, run)) return -1;
+    } while (length);
+    return 0;
+}
+
+
+static int
+write_record(FILE *run, char const *string)
+{
+    size_t length = strlen(string);
+    if (-1 == write_length(run, length)) return -1;
+    if (fwrite(string, 1, length, run) != length) return -1;
+    return 0;
+}
+
+
+// Returns 1 if the source has a current string, 0 if it is exhausted and -1
+// on error.
+static int
+source_advance(struct source *source)
+{
+    if (!source->run) {
+        if (source->index >= source->strings_count) {
+            source->current = NULL;
+            return 0;
+        }
+        source->current = source->strings[source->index++];
+        return 1;
+    }
+    
+    size_t length;
+    int result = read_length(source->run, &length);
+    if (1 != result) {
+        source->current = NULL;
+        return result;
+    }
+    
+    result = ensure_capacity(&source->record,
+                             &source->record_capacity,
+                             length + 1);
+    if (-1 == result) return -1;
+    
+    if (fread(source->record, 1, length, source->run) != length) {
+        if (!ferror(source->run)) errno = EIO;
+        return -1;
+    }
+    source->record[length] = '\0';
+    source->current = source->record;
+    return 1;
+}
+
+
+static bool
+source_is_less(struct source const *first, struct source const *second)
+{
+    return strcmp(first->current, second->current) < 0;
+}
+
+
+static void
+merge_sift_down(struct merge *merge, size_t index)
+{
+    for (;;) {
+        size_t smallest = index;
+        size_t left = 2 * index + 1;
+        size_t right = left + 1;
+        if (   left < merge->heap_count
+            && source_is_less(merge->heap[left], merge->heap[smallest]))
+        {
+            smallest = left;
+        }
+        if (   right < merge->heap_count
+            && source_is_less(merge->heap[right], merge->heap[smallest]))
+        {
+            smallest = right;
+        }
+        if (smallest == index) return;
+        
+        struct source *temp = merge->heap[index];
+        merge->heap[index] = merge->heap[smallest];
+        merge->heap[smallest] = temp;
+        index = smallest;
+    }
+}
+
+
+static void
+merge_close(struct merge *merge)
+{
+    for (size_t i = 0; i < merge->source_count; ++i) {
+        free(merge->sources[i].record);
+    }
+    free(merge->sources);
+    free(merge->heap);
+    free(merge->last);
+    memset(merge, 0, sizeof(struct merge));
+}
+
+
+// Open a merge over sorted, deduplicated runs and an optional sorted,
+// deduplicated array of strings.
+static int
+merge_open(struct merge *merge,
+           FILE *const *runs,
+           size_t run_count,
+           char **strings,
+           size_t strings_count)
+{
+    memset(merge, 0, sizeof(struct merge));
+    
+    merge->sources = calloc(run_count + 1, sizeof(struct source));
+    merge->heap = calloc(run_count + 1, sizeof(struct source *));
+    if (!merge->sources || !merge->heap) {
+        merge_close(merge);
+        return -1;
+    }
+    merge->source_count = run_count + 1;
+    
+    for (size_t i = 0; i < merge->source_count; ++i) {
+        struct source *source = &merge->sources[i];
+        if (i < run_count) {
+            source->run = runs[i];
+            if (-1 == fseek(source->run, 0, SEEK_SET)) {
+                merge_close(merge);
+                return -1;
+            }
+        } else {
+            source->strings = strings;
+            source->strings_count = strings_count;
+        }
+        
+        int result = source_advance(source);
+        if (-1 == result) {
+            merge_close(merge);
+            return -1;
+        }
+        if (result) {
+            merge->heap[merge->heap_count] = source;
+            ++merge->heap_count;
+        }
+    }
+    
+    for (size_t i = merge->heap_count / 2; i > 0; --i) {
+        merge_sift_down(merge, i - 1);
+    }
+    return 0;
+}
+
+
+// Yield the next distinct string of a merge.  Returns 1 and sets `string'
+// on success, 0 when the merge is exhausted and -1 on error.  The yielded
+// string is valid until the next call.
+static int
+merge_next(struct merge *merge, char const **string)
+{
+    while (merge->heap_count) {
+        struct source *top = merge->heap[0];
+        bool is_duplicate = merge->has_last
+                         && 0 == strcmp(top->current, merge->last);
+        if (!is_duplicate) {
+            size_t size = strlen(top->current) + 1;
+            int result = ensure_capacity(&merge->last,
+                                         &merge->last_capacity,
+                                         size);
+            if (-1 == result) return -1;
+            memcpy(merge->last, top->current, size);
+            merge->has_last = true;
+        }
+        
+        int result = source_advance(top);
+        if (-1 == result) return -1;
+        if (!result) {
+            merge->heap[0] = merge->heap[merge->heap_count - 1];
+            --merge->heap_count;
+        }
+        if (merge->heap_count) merge_sift_down(merge, 0);
+        
+        if (!is_duplicate) {
+            *string = merge->last;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static void
+free_buffer_strings(struct stringset_external *external)
+{
+    for (size_t i = 0; i < external->buffer_count; ++i) {
+        free(external->buffer[i]);
+    }
+    external->buffer_count = 0;
+    external->buffer_size = 0;
+}
+
+
+static void
+sort_buffer(struct stringset_external *external)
+{
+    if (!external->buffer_count) return;
+    
+    qsort(external->buffer,
+          external->buffer_count,
+          sizeof(char *),
+          compare_strings);
+    
+    size_t count = 1;
+    for (size_t i = 1; i < external->buffer_count; ++i) {
+        if (0 == strcmp(external->buffer[i], external->buffer[count - 1])) {
+            external->buffer_size -= strlen(external->buffer[i]) + 1;
+            external->buffer_size -= sizeof(char *);
+            free(external->buffer[i]);
+        } else {
+            external->buffer[count] = external->buffer[i];
+            ++count;
+        }
+    }
+    external->buffer_count = count;
+}
+
+
+static int
+append_run(struct stringset_external *external, FILE *run)
+{
+    size_t new_count = external->run_count + 1;
+    FILE **new_runs = realloc(external->runs, sizeof(FILE *) * new_count);
+    if (!new_runs) return -1;
+    external->runs = new_runs;
+    
+    size_t *new_tiers = realloc(external->run_tiers,
+                                sizeof(size_t) * new_count);
+    if (!new_tiers) return -1;
+    external->run_tiers = new_tiers;
+    
+    external->runs[external->run_count] = run;
+    external->run_tiers[external->run_count] = 0;
+    ++external->run_count;
+    return 0;
+}
+
+
+// Merge the newest `count' runs into a single new run of the next tier.
+static int
+merge_runs(struct stringset_external *external, size_t count)
+{
+    size_t index = external->run_count - count;
+    FILE *run = open_run(external);
+    if (!run) return -1;
+    
+    struct merge merge;
+    if (-1 == merge_open(&merge, &external->runs[index], count, NULL, 0)) {
+        fclose(run);
+        return -1;
+    }
+    
+    int result;
+    char const *string;
+    while (1 == (result = merge_next(&merge, &string))) {
+        if (-1 == write_record(run, string)) {
+            result = -1;
+            break;
+        }
+    }
+    merge_close(&merge);
+    if (-1 == result || EOF == fflush(run)) {
+        fclose(run);
+        return -1;
+    }
+    
+    for (size_t i = index; i < index + count; ++i) {
+        fclose(external->runs[i]);
+    }
+    external->runs[index] = run;
+    ++external->run_tiers[index];
+    external->run_count = index + 1;
+    return 0;
+}
+
+
+// Merge runs while the newest `MERGE_FANOUT' runs are in the same tier.
+// Tiers never increase from older runs to newer ones, so the oldest and
+// newest of them are compared.
+static int
+merge_tiers(struct stringset_external *external)
+{
+    while (external->run_count >= MERGE_FANOUT) {
+        size_t *tiers = external->run_tiers;
+        size_t newest = external->run_count - 1;
+        if (tiers[newest + 1 - MERGE_FANOUT] != tiers[newest]) return 0;
+        if (-1 == merge_runs(external, MERGE_FANOUT)) return -1;
+    }
+    return 0;
+}
+
+
+static int
+spill(struct stringset_external *external)
+{
+    sort_buffer(external);
+    if (!external->buffer_count) return 0;
+    
+    FILE *run = open_run(external);
+    if (!run) return -1;
+    
+    for (size_t i = 0; i < external->buffer_count; ++i) {
+        if (-1 == write_record(run, external->buffer[i])) {
+            fclose(run);
+            return -1;
+        }
+    }
+    if (EOF == fflush(run) || -1 == append_run(external, run)) {
+        fclose(run);
+        return -1;
+    }
+    
+    free_buffer_strings(external);
+    return merge_tiers(external);
+}
+
+
+static int
+open_external(struct merge *merge, struct stringset_external *external)
+{
+    sort_buffer(external);
+    return merge_open(merge,
+                      external->runs,
+                      external->run_count,
+                      external->buffer,
+                      external->buffer_count);
+}
+
+
+static int
+combine(struct stringset_external *first,
+        struct stringset_external *second,
+        enum operation operation,
+        stringset_external_callback callback,
+        void *context)
+{
+    if (!first || !second || !callback) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    if (first == second) {
+        if (operation_difference == operation) return 0;
+        return stringset_external_for_each(first, callback, context);
+    }
+    
+    struct merge first_merge;
+    if (-1 == open_external(&first_merge, first)) return -1;
+    struct merge second_merge;
+    if (-1 == open_external(&second_merge, second)) {
+        merge_close(&first_merge);
+        return -1;
+    }
+    
+    char const *first_string = NULL;
+    char const *second_string = NULL;
+    int first_result = merge_next(&first_merge, &first_string);
+    int second_result = merge_next(&second_merge, &second_string);
+    int result = 0;
+    while (first_result > 0 || second_result > 0) {
+        if (-1 == first_result || -1 == second_result) {
+            result = -1;
+            break;
+        }
+        if (operation_union != operation && !first_result) break;
+        if (operation_intersection == operation && !second_result) break;
+        
+        int order;
+        if (!first_result) order = 1;
+        else if (!second_result) order = -1;
+        else order = strcmp(first_string, second_string);
+        
+        char const *output = NULL;
+        if (order < 0) {
+            if (operation_intersection != operation) output = first_string;
+        } else if (order > 0) {
+            if (operation_union == operation) output = second_string;
+        } else {
+            if (operation_difference != operation) output = first_string;
+        }
+        if (output) {
+            result = callback(output, context);
+            if (result) break;
+        }
+        
+        if (order <= 0) {
+            first_result = merge_next(&first_merge, &first_string);
+        }
+        if (order >= 0) {
+            second_result = merge_next(&second_merge, &second_string);
+        }
+    }
+    
+    merge_close(&first_merge);
+    merge_close(&second_merge);
+    return result;
+}
+
+
+struct stringset_external *
+stringset_external_alloc(size_t memory_budget, char const *directory)
+{
+    struct stringset_external *external = calloc(
+        1,
+        sizeof(struct stringset_external));
+    if (!external) return NULL;
+    
+    external->memory_budget = memory_budget;
+    if (directory) {
+        external->directory = strdup(directory);
+        if (!external->directory) {
+            free(external);
+            return NULL;
+        }
+    }
+    return external;
+}
+
+
+int
+stringset_external_add(struct stringset_external *external,
+                       char const *string)
+{
+    if (!external || !string) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    if (external->buffer_count == external->buffer_capacity) {
+        size_t new_capacity = external->buffer_capacity
+                            ? 2 * external->buffer_capacity
+                            : 64;
+        char **new_buffer = realloc(external->buffer,
+                                    sizeof(char *) * new_capacity);
+        if (!new_buffer) return -1;
+        external->buffer = new_buffer;
+        external->buffer_capacity = new_capacity;
+    }
+    
+    char *copy = strdup(string);
+    if (!copy) return -1;
+    external->buffer[external->buffer_count] = copy;
+    ++external->buffer_count;
+    external->buffer_size += strlen(copy) + 1 + sizeof(char *);
+    
+    if (external->buffer_size > external->memory_budget) return spill(external);
+    return 0;
+}
+
+
+int
+stringset_external_add_array(struct stringset_external *external,
+                             char const *const *array,
+                             size_t count)
+{
+    if (!external || !array) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        int result = stringset_external_add(external, array[i]);
+        if (-1 == result) return -1;
+    }
+    return 0;
+}
+
+
+int
+stringset_external_difference(struct stringset_external *first,
+                              struct stringset_external *second,
+                              stringset_external_callback callback,
+                              void *context)
+{
+    return combine(first, second, operation_difference, callback, context);
+}
+
+
+int
+stringset_external_for_each(struct stringset_external *external,
+                            stringset_external_callback callback,
+                            void *context)
+{
+    if (!external || !callback) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    struct merge merge;
+    if (-1 == open_external(&merge, external)) return -1;
+    
+    int result;
+    char const *string;
+    while (1 == (result = merge_next(&merge, &string))) {
+        result = callback(string, context);
+        if (result) break;
+    }
+    merge_close(&merge);
+    return result;
+}
+
+
+void
+stringset_external_free(struct stringset_external *external)
+{
+    if (external) {
+        free_buffer_strings(external);
+        free(external->buffer);
+        for (size_t i = 0; i < external->run_count; ++i) {
+            fclose(external->runs[i]);
+        }
+        free(external->runs);
+        free(external->run_tiers);
+        free(external->directory);
+        free(external);
+    }
+}
+
+
+int
+stringset_external_intersection(struct stringset_external *first,
+                                struct stringset_external *second,
+                                stringset_external_callback callback,
+                                void *context)
+{
+    return combine(first, second, operation_intersection, callback, context);
+}
+
+
+size_t
+stringset_external_run_count(struct stringset_external const *external)
+{
+    return external ? external->run_count : 0;
+}
+
+
+int
+stringset_external_union(struct stringset_external *first,
+                         struct stringset_external *second,
+                         stringset_external_callback callback,
+                         void *context)
+{
+    return combine(first, second, operation_union, callback, context);
+}
+
+
+int
+stringset_external_write(struct stringset_external *external, FILE *file)
+{
+    if (!file) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return stringset_external_for_each(external,
+                                       stringset_external_write_line,
+                                       file);
+}
+
+
+int
+stringset_external_write_line(char const *string, void *context)
+{
+    FILE *file = context;
+    if (EOF == fputs(string, file)) return -1;
+    if (EOF == putc('\n', file)) return -1;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#ifndef STRINGSET_EXTERNAL_H_INCLUDED
+#define STRINGSET_EXTERNAL_H_INCLUDED
+
+
+#include <stddef.h>
+#include <stdio.h>
+
+
+// An external string set holds more distinct members than fit in memory.
+// Added strings are buffered in memory until the buffer exceeds a memory
+// budget, then the buffer is sorted, deduplicated and spilled to a temporary
+// file as a sorted run.  Runs of similar size are merged in tiers, so each
+// string is rewritten a logarithmic number of times and the number of open
+// runs grows only logarithmically.  Members are materialized by a k-way merge
+// of the runs and the in-memory buffer, in `strcmp()' order with duplicates
+// removed.
+struct stringset_external;
+
+// Called once for each member produced by an external string set operation,
+// in sorted order.  Like a `stringset_visitor', return 0 to continue or any
+// other value to stop the operation, which then returns that value.  The
+// operations return 0 once every member has been produced and -1 on error.
+typedef int
+(*stringset_external_callback)(char const *string, void *context);
+
+
+/****************************
+ * Creation and destruction *
+ ****************************/
+
+// Allocate an empty external string set.  Members are buffered in memory
+// until they use more than `memory_budget' bytes, then spilled to a temporary
+// file in `directory'.  If `directory' is NULL, the default temporary
+// directory is used.  Temporary files are unlinked when created and are
+// released when the external string set is freed.
+struct stringset_external *
+stringset_external_alloc(size_t memory_budget, char const *directory);
+
+// Delete all members and temporary files and free an allocated external
+// string set.
+void
+stringset_external_free(struct stringset_external *external);
+
+
+/******************
+ * Insert members *
+ ******************/
+
+// Add a string to an external string set.  The string is copied.  Duplicate
+// strings are removed when runs are spilled and merged.
+int
+stringset_external_add(struct stringset_external *external,
+                       char const *string);
+
+// Add an array of strings to an external string set.
+int
+stringset_external_add_array(struct stringset_external *external,
+                             char const *const *array,
+                             size_t count);
+
+// The number of sorted runs spilled to temporary files so far.
+size_t
+stringset_external_run_count(struct stringset_external const *external);
+
+
+/***************
+ * Materialize *
+ ***************/
+
+// Call `callback' once for each distinct member of an external string set,
+// in sorted order.
+int
+stringset_external_for_each(struct stringset_external *external,
+                            stringset_external_callback callback,
+                            void *context);
+
+// Write each distinct member of an external string set to `file', in sorted
+// order, one member per line.
+int
+stringset_external_write(struct stringset_external *external, FILE *file);
+
+// A callback that writes `string' and a newline to the `FILE *' passed as
+// `context'.  Pass this to the set operations below to write their results
+// to a file.
+int
+stringset_external_write_line(char const *string, void *context);
+
+
+/******************
+ * Set operations *
+ ******************/
+
+// Call `callback' for each member of the union of two external string sets.
+int
+stringset_external_union(struct stringset_external *first,
+                         struct stringset_external *second,
+                         stringset_external_callback callback,
+                         void *context);
+
+// Call `callback' for each member of the intersection of two external string
+// sets.
+int
+stringset_external_intersection(struct stringset_external *first,
+                                struct stringset_external *second,
+                                stringset_external_callback callback,
+                                void *context);
+
+// Call `callback' for each member of `first' that is not a member of
+// `second'.
+int
+stringset_external_difference(struct stringset_external *first,
+                              struct stringset_external *second,
+                              stringset_external_callback callback,
+                              void *context);
+
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef STRINGSET_HASH_H_INCLUDED
+#define STRINGSET_HASH_H_INCLUDED
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "stringset.h"
+
+
+// String hashing shared by the string set implementations.  This header is
+// private to the library.
+
+
+static inline int
+fold_case(unsigned char c)
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+
+// Hash a string so that strings equal in a string set order hash equally.
+// The low bits are good enough for a hash table index; pass the hash to
+// `mix_hash()' before using its high bits.
+static inline uint64_t
+hash_string(enum stringset_order order, char const *string)
+{
+    uint64_t hash = UINT64_C(14695981039346656037);
+    bool is_case_folded = stringset_order_case_folded == order;
+    for (unsigned char const *s = (unsigned char const *)string; *s; ++s) {
+        hash ^= is_case_folded ? fold_case(*s) : *s;
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+
+// Finish a string hash so that all of its bits depend on every input byte.
+static inline uint64_t
+mix_hash(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    hash ^= hash >> 33;
+    return hash;
+}
+
+
+#endif
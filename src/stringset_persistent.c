@@ -0,0 +1,793 @@
+#include "stringset_persistent.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// A member string shared by the nodes of every version that contains it.
+struct shared_string {
+    size_t reference_count;
+    char bytes[];
+};
+
+
+// A node of an AVL tree.  Nodes are never modified after they are built, so
+// deriving a version copies the nodes on the paths to the changed members and
+// shares all the others.  `count' is the number of members in the subtree.
+struct node {
+    size_t reference_count;
+    struct node *left;
+    struct node *right;
+    struct shared_string *string;
+    size_t count;
+    int height;
+};
+
+
+struct stringset_persistent {
+    struct node *root;
+};
+
+
+// The functions below take borrowed references to the nodes passed to them
+// and return a new reference, unless a parameter is documented as consumed.
+// When an allocation fails they set `*failed' and carry on with an empty
+// subtree, and the caller releases the incomplete result.
+
+
+static struct shared_string *
+alloc_string(char const *string)
+{
+    size_t size = strlen(string) + 1;
+    struct shared_string *shared = malloc(sizeof(struct shared_string) + size);
+    if (!shared) return NULL;
+    
+    shared->reference_count = 1;
+    memcpy(shared->bytes, string, size);
+    return shared;
+}
+
+
+static void
+release_string(struct shared_string *string)
+{
+    if (0 == --string->reference_count) free(string);
+}
+
+
+static size_t
+count(struct node const *node)
+{
+    return node ? node->count : 0;
+}
+
+
+static int
+height(struct node const *node)
+{
+    return node ? node->height : 0;
+}
+
+
+static struct node *
+retain(struct node *node)
+{
+    if (node) ++node->reference_count;
+    return node;
+}
+
+
+static void
+release(struct node *node)
+{
+    while (node && 0 == --node->reference_count) {
+        struct node *right = node->right;
+        release(node->left);
+        release_string(node->string);
+        free(node);
+        node = right;
+    }
+}
+
+
+// Build a node, consuming `left' and `right'.
+static struct node *
+make_node(struct node *left,
+          struct shared_string *string,
+          struct node *right,
+          bool *failed)
+{
+    struct node *node = malloc(sizeof(struct node));
+    if (!node) {
+        release(left);
+        release(right);
+        *failed = true;
+        return NULL;
+    }
+    
+    int left_height = height(left);
+    int right_height = height(right);
+    int max_height = left_height > right_height ? left_height : right_height;
+    node->reference_count = 1;
+    node->left = left;
+    node->right = right;
+    node->string = string;
+    ++string->reference_count;
+    node->count = count(left) + 1 + count(right);
+    node->height = max_height + 1;
+    return node;
+}
+
+
+// Build a node whose subtree heights differ by at most two, rotating it to
+// restore the AVL balance.  Consumes `left' and `right'.
+static struct node *
+balance(struct node *left,
+        struct shared_string *string,
+        struct node *right,
+        bool *failed)
+{
+    struct node *node;
+    if (height(left) > height(right) + 1) {
+        struct node *left_right = left->right;
+        if (height(left->left) >= height(left_right)) {
+            node = make_node(retain(left->left),
+                             left->string,
+                             make_node(retain(left_right),
+                                       string,
+                                       right,
+                                       failed),
+                             failed);
+        } else {
+            node = make_node(make_node(retain(left->left),
+                                       left->string,
+                                       retain(left_right->left),
+                                       failed),
+                             left_right->string,
+                             make_node(retain(left_right->right),
+                                       string,
+                                       right,
+                                       failed),
+                             failed);
+        }
+        release(left);
+    } else if (height(right) > height(left) + 1) {
+        struct node *right_left = right->left;
+        if (height(right->right) >= height(right_left)) {
+            node = make_node(make_node(left,
+                                       string,
+                                       retain(right_left),
+                                       failed),
+                             right->string,
+                             retain(right->right),
+                             failed);
+        } else {
+            node = make_node(make_node(left,
+                                       string,
+                                       retain(right_left->left),
+                                       failed),
+                             right_left->string,
+                             make_node(retain(right_left->right),
+                                       right->string,
+                                       retain(right->right),
+                                       failed),
+                             failed);
+        }
+        release(right);
+    } else {
+        node = make_node(left, string, right, failed);
+    }
+    return node;
+}
+
+
+// Join two trees and a string that sorts between them, descending the spine
+// of the taller tree to where the heights match.  Consumes `left' and
+// `right'.
+static struct node *
+join(struct node *left,
+     struct shared_string *string,
+     struct node *right,
+     bool *failed)
+{
+    struct node *node;
+    if (height(left) > height(right) + 1) {
+        node = balance(retain(left->left),
+                       left->string,
+                       join(retain(left->right), string, right, failed),
+                       failed);
+        release(left);
+    } else if (height(right) > height(left) + 1) {
+        node = balance(join(left, string, retain(right->left), failed),
+                       right->string,
+                       retain(right->right),
+                       failed);
+        release(right);
+    } else {
+        node = make_node(left, string, right, failed);
+    }
+    return node;
+}
+
+
+// Copy a tree without its last member, which is stored in `*last'.
+static struct node *
+remove_last(struct node *node, struct shared_string **last, bool *failed)
+{
+    if (!node->right) {
+        *last = node->string;
+        return retain(node->left);
+    }
+    return balance(retain(node->left),
+                   node->string,
+                   remove_last(node->right, last, failed),
+                   failed);
+}
+
+
+// Join two trees where every member of `left' sorts before every member of
+// `right'.  Consumes `left' and `right'.
+static struct node *
+join_trees(struct node *left, struct node *right, bool *failed)
+{
+    if (!left) return right;
+    if (!right) return left;
+    
+    struct shared_string *last;
+    struct node *rest = remove_last(left, &last, failed);
+    struct node *node = join(rest, last, right, failed);
+    release(left);
+    return node;
+}
+
+
+// Split a tree into the members that sort before and after `string'.
+// Returns true if `string' is a member.
+static bool
+split(struct node *node,
+      char const *string,
+      struct node **left,
+      struct node **right,
+      bool *failed)
+{
+    if (!node) {
+        *left = NULL;
+        *right = NULL;
+        return false;
+    }
+    
+    int order = strcmp(string, node->string->bytes);
+    if (order < 0) {
+        struct node *right_part;
+        bool is_member = split(node->left, string, left, &right_part, failed);
+        *right = join(right_part, node->string, retain(node->right), failed);
+        return is_member;
+    } else if (order > 0) {
+        struct node *left_part;
+        bool is_member = split(node->right, string, &left_part, right, failed);
+        *left = join(retain(node->left), node->string, left_part, failed);
+        return is_member;
+    }
+    *left = retain(node->left);
+    *right = retain(node->right);
+    return true;
+}
+
+
+static struct node *
+build(char const *const *members, size_t count, bool *failed)
+{
+    if (!count) return NULL;
+    
+    size_t middle = count / 2;
+    struct node *left = build(members, middle, failed);
+    struct node *right = build(members + middle + 1,
+                               count - middle - 1,
+                               failed);
+    struct shared_string *string = alloc_string(members[middle]);
+    if (!string) {
+        release(left);
+        release(right);
+        *failed = true;
+        return NULL;
+    }
+    
+    struct node *node = make_node(left, string, right, failed);
+    release_string(string);
+    return node;
+}
+
+
+static bool
+contains(struct node const *node, char const *string)
+{
+    while (node) {
+        int order = strcmp(string, node->string->bytes);
+        if (!order) return true;
+        node = order < 0 ? node->left : node->right;
+    }
+    return false;
+}
+
+
+// Check whether `other' contains all (or none) of the members of `node'.
+static bool
+contains_all(struct node const *node,
+             struct node const *other,
+             bool is_contained)
+{
+    while (node) {
+        if (contains(other, node->string->bytes) != is_contained) {
+            return false;
+        }
+        if (!contains_all(node->left, other, is_contained)) return false;
+        node = node->right;
+    }
+    return true;
+}
+
+
+static int
+for_each(struct node const *node,
+         stringset_persistent_callback callback,
+         void *context)
+{
+    while (node) {
+        int result = for_each(node->left, callback, context);
+        if (result) return result;
+        result = callback(node->string->bytes, context);
+        if (result) return result;
+        node = node->right;
+    }
+    return 0;
+}
+
+
+static struct node *
+insert(struct node *node, struct shared_string *string, bool *failed)
+{
+    if (!node) return make_node(NULL, string, NULL, failed);
+    
+    int order = strcmp(string->bytes, node->string->bytes);
+    if (order < 0) {
+        return balance(insert(node->left, string, failed),
+                       node->string,
+                       retain(node->right),
+                       failed);
+    } else if (order > 0) {
+        return balance(retain(node->left),
+                       node->string,
+                       insert(node->right, string, failed),
+                       failed);
+    }
+    return retain(node);
+}
+
+
+static struct node *
+erase(struct node *node, char const *string, bool *failed)
+{
+    if (!node) return NULL;
+    
+    int order = strcmp(string, node->string->bytes);
+    if (order < 0) {
+        return balance(erase(node->left, string, failed),
+                       node->string,
+                       retain(node->right),
+                       failed);
+    } else if (order > 0) {
+        return balance(retain(node->left),
+                       node->string,
+                       erase(node->right, string, failed),
+                       failed);
+    }
+    return join_trees(retain(node->left), retain(node->right), failed);
+}
+
+
+// Combine two trees by splitting `second' at the root of `first', combining
+// the halves recursively and joining the results.  Members only in `first',
+// only in `second' and in both are kept if `keeps_first', `keeps_second' and
+// `keeps_common' are true.  Identical subtrees are combined without visiting
+// them.
+static struct node *
+combine(struct node *first,
+        struct node *second,
+        bool keeps_first,
+        bool keeps_second,
+        bool keeps_common,
+        bool *failed)
+{
+    if (!first) return keeps_second ? retain(second) : NULL;
+    if (!second) return keeps_first ? retain(first) : NULL;
+    if (first == second) return keeps_common ? retain(first) : NULL;
+    
+    struct node *left;
+    struct node *right;
+    char const *string = first->string->bytes;
+    bool is_common = split(second, string, &left, &right, failed);
+    struct node *combined_left = combine(first->left,
+                                         left,
+                                         keeps_first,
+                                         keeps_second,
+                                         keeps_common,
+                                         failed);
+    struct node *combined_right = combine(first->right,
+                                          right,
+                                          keeps_first,
+                                          keeps_second,
+                                          keeps_common,
+                                          failed);
+    release(left);
+    release(right);
+    
+    if (is_common ? keeps_common : keeps_first) {
+        return join(combined_left, first->string, combined_right, failed);
+    }
+    return join_trees(combined_left, combined_right, failed);
+}
+
+
+// Wrap a tree in a new version, consuming `root'.
+static struct stringset_persistent *
+alloc_version(struct node *root, bool failed)
+{
+    if (failed) {
+        release(root);
+        errno = ENOMEM;
+        return NULL;
+    }
+    
+    struct stringset_persistent *persistent;
+    persistent = malloc(sizeof(struct stringset_persistent));
+    if (!persistent) {
+        release(root);
+        return NULL;
+    }
+    persistent->root = root;
+    return persistent;
+}
+
+
+static struct stringset_persistent *
+alloc_combined(struct stringset_persistent const *first,
+               struct stringset_persistent const *second,
+               bool keeps_first,
+               bool keeps_second,
+               bool keeps_common)
+{
+    if (!first || !second) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    bool failed = false;
+    struct node *root = combine(first->root,
+                                second->root,
+                                keeps_first,
+                                keeps_second,
+                                keeps_common,
+                                &failed);
+    return alloc_version(root, failed);
+}
+
+
+static int
+add_to_stringset(char const *string, void *context)
+{
+    return stringset_add(context, string);
+}
+
+
+static int
+compare_strings(void const *first, void const *second)
+{
+    char const *const *first_string = first;
+    char const *const *second_string = second;
+    return strcmp(*first_string, *second_string);
+}
+
+
+// Build a version from an array of strings, consuming `members'.  Unless
+// `is_sorted', the array is sorted in `strcmp()' order and deduplicated
+// first.
+static struct stringset_persistent *
+alloc_from_members(char const **members, size_t count, bool is_sorted)
+{
+    if (!is_sorted && count) {
+        qsort(members, count, sizeof(char *), compare_strings);
+        size_t unique_count = 1;
+        for (size_t i = 1; i < count; ++i) {
+            if (strcmp(members[i], members[unique_count - 1])) {
+                members[unique_count++] = members[i];
+            }
+        }
+        count = unique_count;
+    }
+    
+    bool failed = false;
+    struct node *root = build(members, count, &failed);
+    free(members);
+    return alloc_version(root, failed);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc(void)
+{
+    return alloc_version(NULL, false);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc_difference(
+    struct stringset_persistent const *first,
+    struct stringset_persistent const *second)
+{
+    return alloc_combined(first, second, true, false, false);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc_from_array(char const *const *array, size_t count)
+{
+    if (!array) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (count > SIZE_MAX / sizeof(char *)) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+    
+    char const **members = malloc(sizeof(char *) * (count ? count : 1));
+    if (!members) return NULL;
+    memcpy(members, array, sizeof(char *) * count);
+    return alloc_from_members(members, count, false);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc_from_stringset(struct stringset const *stringset)
+{
+    if (!stringset) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    // Starting the cursor merges any pending members, so `count' is then
+    // the number of members.
+    struct stringset_cursor cursor;
+    stringset_cursor_init(&cursor, stringset, false);
+    size_t count = stringset->count;
+    char const **members = malloc(sizeof(char *) * (count ? count : 1));
+    if (!members) return NULL;
+    for (size_t i = 0; i < count; ++i) {
+        members[i] = stringset_cursor_next(&cursor);
+    }
+    
+    // Members of a set in another order are distinct in `strcmp()' order
+    // too, but must be sorted again.
+    bool is_sorted = stringset_order_lexical == stringset->order;
+    return alloc_from_members(members, count, is_sorted);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc_intersection(
+    struct stringset_persistent const *first,
+    struct stringset_persistent const *second)
+{
+    return alloc_combined(first, second, false, false, true);
+}
+
+
+struct stringset *
+stringset_persistent_alloc_stringset(
+    struct stringset_persistent const *persistent)
+{
+    if (!persistent) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset *stringset = stringset_alloc();
+    if (!stringset) return NULL;
+    
+    if (   -1 == stringset_set_deferred(stringset, true)
+        || -1 == for_each(persistent->root, add_to_stringset, stringset)
+        || -1 == stringset_set_deferred(stringset, false))
+    {
+        stringset_free(stringset);
+        return NULL;
+    }
+    return stringset;
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc_symmetric_difference(
+    struct stringset_persistent const *first,
+    struct stringset_persistent const *second)
+{
+    return alloc_combined(first, second, true, true, false);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_alloc_union(struct stringset_persistent const *first,
+                                 struct stringset_persistent const *second)
+{
+    return alloc_combined(first, second, true, true, true);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_add(struct stringset_persistent const *persistent,
+                         char const *string)
+{
+    if (!persistent || !string) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    if (contains(persistent->root, string)) {
+        return alloc_version(retain(persistent->root), false);
+    }
+    
+    struct shared_string *shared = alloc_string(string);
+    if (!shared) return NULL;
+    
+    bool failed = false;
+    struct node *root = insert(persistent->root, shared, &failed);
+    release_string(shared);
+    return alloc_version(root, failed);
+}
+
+
+bool
+stringset_persistent_contains(struct stringset_persistent const *persistent,
+                              char const *string)
+{
+    if (!persistent || !string) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    return contains(persistent->root, string);
+}
+
+
+size_t
+stringset_persistent_count(struct stringset_persistent const *persistent)
+{
+    return persistent ? count(persistent->root) : 0;
+}
+
+
+int
+stringset_persistent_for_each(struct stringset_persistent const *persistent,
+                              stringset_persistent_callback callback,
+                              void *context)
+{
+    if (!persistent || !callback) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return for_each(persistent->root, callback, context);
+}
+
+
+void
+stringset_persistent_free(struct stringset_persistent *persistent)
+{
+    if (persistent) {
+        release(persistent->root);
+        free(persistent);
+    }
+}
+
+
+bool
+stringset_persistent_is_disjoint_from(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other)
+{
+    if (!persistent || !other) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    struct node const *smaller = persistent->root;
+    struct node const *larger = other->root;
+    if (count(smaller) > count(larger)) {
+        smaller = other->root;
+        larger = persistent->root;
+    }
+    return contains_all(smaller, larger, false);
+}
+
+
+bool
+stringset_persistent_is_equal_to(struct stringset_persistent const *persistent,
+                                 struct stringset_persistent const *other)
+{
+    if (!persistent || !other) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    if (count(persistent->root) != count(other->root)) return false;
+    return stringset_persistent_is_subset_of(persistent, other);
+}
+
+
+bool
+stringset_persistent_is_proper_subset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other)
+{
+    if (!persistent || !other) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    if (count(persistent->root) >= count(other->root)) return false;
+    return stringset_persistent_is_subset_of(persistent, other);
+}
+
+
+bool
+stringset_persistent_is_proper_superset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other)
+{
+    return stringset_persistent_is_proper_subset_of(other, persistent);
+}
+
+
+bool
+stringset_persistent_is_subset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other)
+{
+    if (!persistent || !other) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    if (persistent->root == other->root) return true;
+    if (count(persistent->root) > count(other->root)) return false;
+    return contains_all(persistent->root, other->root, true);
+}
+
+
+bool
+stringset_persistent_is_superset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other)
+{
+    return stringset_persistent_is_subset_of(other, persistent);
+}
+
+
+struct stringset_persistent *
+stringset_persistent_remove(struct stringset_persistent const *persistent,
+                            char const *string)
+{
+    if (!persistent || !string) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    bool failed = false;
+    struct node *root = retain(persistent->root);
+    if (contains(root, string)) {
+        release(root);
+        root = erase(persistent->root, string, &failed);
+    }
+    return alloc_version(root, failed);
+}
@@ -0,0 +1,159 @@
+#ifndef STRINGSET_PERSISTENT_H_INCLUDED
+#define STRINGSET_PERSISTENT_H_INCLUDED
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "stringset.h"
+
+
+// A persistent string set is an immutable version of a set of strings.
+// Adding or removing a member returns a new version and leaves the old one
+// unchanged.  Versions are balanced binary trees that share every unchanged
+// node by reference counting, so each new version costs O(log N) memory and
+// time instead of a copy of the whole set.  Members are always in `strcmp()'
+// order, like `stringset_order_lexical'; other orders aren't supported.
+//
+// Versions can be read concurrently, but versions that share nodes must not
+// be allocated or freed concurrently.
+struct stringset_persistent;
+
+// Called once for each member of a persistent string set, in sorted order.
+// Like a `stringset_visitor', return 0 to continue or any other value to
+// stop, which `stringset_persistent_for_each()' then returns.
+typedef int
+(*stringset_persistent_callback)(char const *string, void *context);
+
+
+/****************************
+ * Creation and destruction *
+ ****************************/
+
+// Allocate an empty persistent string set.
+struct stringset_persistent *
+stringset_persistent_alloc(void);
+
+// Allocate a persistent string set from an array.  Strings in the array are
+// copied, and duplicates are added once.
+struct stringset_persistent *
+stringset_persistent_alloc_from_array(char const *const *array, size_t count);
+
+// Allocate a persistent string set with the members of a string set.  The
+// strings are copied.  The members of a string set in another order than
+// `stringset_order_lexical' are sorted again in `strcmp()' order.
+struct stringset_persistent *
+stringset_persistent_alloc_from_stringset(struct stringset const *stringset);
+
+// Allocate a string set with the members of a persistent string set.
+struct stringset *
+stringset_persistent_alloc_stringset(
+    struct stringset_persistent const *persistent);
+
+// Free a version of a persistent string set.  Nodes shared with other
+// versions are freed with the last version that refers to them.
+void
+stringset_persistent_free(struct stringset_persistent *persistent);
+
+
+/*******************
+ * Test membership *
+ *******************/
+
+// The number of members of a persistent string set.
+size_t
+stringset_persistent_count(struct stringset_persistent const *persistent);
+
+// Check if a persistent string set contains a string.
+bool
+stringset_persistent_contains(struct stringset_persistent const *persistent,
+                              char const *string);
+
+// Call `callback' for each member of a persistent string set, in sorted
+// order.  Returns 0 once every member has been visited, the value that
+// stopped the visit, or -1 on error.
+int
+stringset_persistent_for_each(struct stringset_persistent const *persistent,
+                              stringset_persistent_callback callback,
+                              void *context);
+
+
+/***********************
+ * Compare string sets *
+ ***********************/
+
+bool
+stringset_persistent_is_disjoint_from(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other);
+
+bool
+stringset_persistent_is_equal_to(struct stringset_persistent const *persistent,
+                                 struct stringset_persistent const *other);
+
+bool
+stringset_persistent_is_proper_subset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other);
+
+bool
+stringset_persistent_is_proper_superset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other);
+
+bool
+stringset_persistent_is_subset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other);
+
+bool
+stringset_persistent_is_superset_of(
+    struct stringset_persistent const *persistent,
+    struct stringset_persistent const *other);
+
+
+/*******************
+ * Derive versions *
+ *******************/
+
+// Allocate a version of a persistent string set with `string' added.  The
+// string is copied.
+struct stringset_persistent *
+stringset_persistent_add(struct stringset_persistent const *persistent,
+                         char const *string);
+
+// Allocate a version of a persistent string set with `string' removed.
+struct stringset_persistent *
+stringset_persistent_remove(struct stringset_persistent const *persistent,
+                            char const *string);
+
+
+/******************
+ * Set operations *
+ ******************/
+
+// The set operations split and join the trees of their operands, so the
+// result shares the subtrees that the operands don't overlap in and an
+// operation on two versions that share most of their nodes is fast.
+
+struct stringset_persistent *
+stringset_persistent_alloc_difference(
+    struct stringset_persistent const *first,
+    struct stringset_persistent const *second);
+
+struct stringset_persistent *
+stringset_persistent_alloc_intersection(
+    struct stringset_persistent const *first,
+    struct stringset_persistent const *second);
+
+struct stringset_persistent *
+stringset_persistent_alloc_symmetric_difference(
+    struct stringset_persistent const *first,
+    struct stringset_persistent const *second);
+
+struct stringset_persistent *
+stringset_persistent_alloc_union(struct stringset_persistent const *first,
+                                 struct stringset_persistent const *second);
+
+
+#endif
@@ -0,0 +1,386 @@
+#include "stringset_queue.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+enum change {
+    change_add,
+    change_remove,
+    change_barrier
+};
+
+
+// A point in the queue that a thread in `stringset_queue_flush()' waits for.
+// `is_applied' is set, with the mutex locked, once every change enqueued
+// before it has been applied.
+struct barrier {
+    bool is_applied;
+};
+
+
+// An enqueued change.  `next' is written atomically by producers while the
+// node is in the queue and links the batch once it is dequeued.
+struct node {
+    struct node *next;
+    enum change change;
+    struct barrier *barrier;
+    char string[];
+};
+
+
+// The queue is a linked list of nodes.  Producers atomically exchange `head',
+// the node enqueued last, then link the previous head to it.  `tail', the
+// next node to dequeue, and the dequeued `batch', newest first, are used only
+// by the thread applying changes.  `stub' is enqueued whenever the last node
+// is dequeued, so the list is never empty.
+struct stringset_queue {
+    struct stringset *stringset;
+    struct node *head;
+    struct node *tail;
+    struct node *stub;
+    struct node *batch;
+    int changes_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t applied;
+    bool is_applying;
+};
+
+
+static struct node *
+alloc_node(enum change change, char const *string)
+{
+    size_t size = strlen(string) + 1;
+    struct node *node = malloc(sizeof(struct node) + size);
+    if (!node) return NULL;
+    
+    node->next = NULL;
+    node->change = change;
+    node->barrier = NULL;
+    memcpy(node->string, string, size);
+    return node;
+}
+
+
+static void
+push(struct stringset_queue *queue, struct node *node)
+{
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    struct node *previous = __atomic_exchange_n(&queue->head,
+                                                node,
+                                                __ATOMIC_ACQ_REL);
+    __atomic_store_n(&previous->next, node, __ATOMIC_RELEASE);
+}
+
+
+// Dequeue the oldest node.  Returns NULL if the queue is empty or if the
+// oldest node's producer hasn't linked it yet.
+static struct node *
+pop(struct stringset_queue *queue)
+{
+    struct node *tail = queue->tail;
+    struct node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (tail == queue->stub) {
+        if (!next) return NULL;
+        queue->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    
+    struct node *head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if (tail != head) return NULL;
+    
+    push(queue, queue->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+
+static bool
+batch_has_barrier(struct stringset_queue const *queue,
+                  struct barrier const *barrier)
+{
+    for (struct node *node = queue->batch; node; node = node->next) {
+        if (node->barrier == barrier) return true;
+    }
+    return false;
+}
+
+
+// Dequeue nodes into the batch until it holds `max_count' changes or the
+// queue is empty.  If `barrier' isn't NULL, dequeue until its node instead,
+// waiting for producers that enqueued nodes before it to link them.
+static void
+dequeue_batch(struct stringset_queue *queue,
+              int max_count,
+              struct barrier const *barrier)
+{
+    if (barrier && batch_has_barrier(queue, barrier)) return;
+    
+    while (barrier || queue->changes_count < max_count) {
+        struct node *node = pop(queue);
+        if (!node) {
+            if (!barrier) return;
+            sched_yield();
+            continue;
+        }
+        
+        node->next = queue->batch;
+        queue->batch = node;
+        if (change_barrier != node->change) {
+            ++queue->changes_count;
+        } else if (node->barrier == barrier) {
+            return;
+        }
+    }
+}
+
+
+// Remove the node of a barrier whose thread stopped waiting from the batch.
+static void
+remove_barrier(struct stringset_queue *queue, struct barrier const *barrier)
+{
+    for (struct node **link = &queue->batch; *link; link = &(*link)->next) {
+        struct node *node = *link;
+        if (node->barrier == barrier) {
+            *link = node->next;
+            free(node);
+            return;
+        }
+    }
+}
+
+
+// Deduplicate the changes in the batch and apply them to the string set.
+static int
+apply_changes(struct stringset_queue *queue)
+{
+    struct stringset *stringset = queue->stringset;
+    struct stringset_options options = {
+        NULL, stringset->order, stringset->pool, false, false
+    };
+    struct stringset_delta delta = {
+        stringset_alloc_with_options(&options),
+        stringset_alloc_with_options(&options),
+    };
+    int result = delta.added && delta.removed ? 0 : -1;
+    if (0 == result) result = stringset_set_deferred(delta.added, true);
+    if (0 == result) result = stringset_set_deferred(delta.removed, true);
+    
+    // The batch is newest first, so the first change seen to each member is
+    // the last one made.
+    for (struct node *node = queue->batch;
+         node && 0 == result;
+         node = node->next)
+    {
+        if (   change_barrier == node->change
+            || stringset_contains(delta.added, node->string)
+            || stringset_contains(delta.removed, node->string))
+        {
+            continue;
+        }
+        struct stringset *changes = change_add == node->change
+                                  ? delta.added
+                                  : delta.removed;
+        result = stringset_add(changes, node->string);
+    }
+    if (0 == result) result = stringset_apply_delta(stringset, &delta);
+    stringset_free(delta.added);
+    stringset_free(delta.removed);
+    return result;
+}
+
+
+// Apply the changes in the batch, release the threads waiting for its
+// barriers and free it.  Returns the number of changes applied, or -1 and
+// keeps the batch if it can't be applied.
+static int
+apply_batch(struct stringset_queue *queue)
+{
+    if (queue->changes_count && -1 == apply_changes(queue)) return -1;
+    
+    pthread_mutex_lock(&queue->mutex);
+    for (struct node *node = queue->batch; node; node = node->next) {
+        if (node->barrier) node->barrier->is_applied = true;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    
+    while (queue->batch) {
+        struct node *node = queue->batch;
+        queue->batch = node->next;
+        free(node);
+    }
+    int count = queue->changes_count;
+    queue->changes_count = 0;
+    return count;
+}
+
+
+static int
+enqueue(struct stringset_queue *queue, enum change change, char const *string)
+{
+    if (!queue || !string) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    struct node *node = alloc_node(change, string);
+    if (!node) return -1;
+    
+    push(queue, node);
+    return 0;
+}
+
+
+struct stringset_queue *
+stringset_queue_alloc(struct stringset *stringset)
+{
+    if (!stringset) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset_queue *queue = calloc(1, sizeof(struct stringset_queue));
+    if (!queue) return NULL;
+    
+    queue->stub = alloc_node(change_barrier, "");
+    if (!queue->stub) {
+        free(queue);
+        return NULL;
+    }
+    
+    int result = pthread_mutex_init(&queue->mutex, NULL);
+    if (result) {
+        free(queue->stub);
+        free(queue);
+        errno = result;
+        return NULL;
+    }
+    
+    result = pthread_cond_init(&queue->applied, NULL);
+    if (result) {
+        pthread_mutex_destroy(&queue->mutex);
+        free(queue->stub);
+        free(queue);
+        errno = result;
+        return NULL;
+    }
+    
+    queue->stringset = stringset;
+    queue->head = queue->stub;
+    queue->tail = queue->stub;
+    return queue;
+}
+
+
+void
+stringset_queue_free(struct stringset_queue *queue)
+{
+    if (queue) {
+        struct node *node;
+        while ((node = pop(queue))) free(node);
+        while (queue->batch) {
+            node = queue->batch;
+            queue->batch = node->next;
+            free(node);
+        }
+        
+        pthread_cond_destroy(&queue->applied);
+        pthread_mutex_destroy(&queue->mutex);
+        free(queue->stub);
+        free(queue);
+    }
+}
+
+
+int
+stringset_queue_add(struct stringset_queue *queue, char const *string)
+{
+    return enqueue(queue, change_add, string);
+}
+
+
+int
+stringset_queue_apply(struct stringset_queue *queue, int max_count)
+{
+    if (!queue || max_count < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->is_applying) {
+        pthread_cond_wait(&queue->applied, &queue->mutex);
+    }
+    queue->is_applying = true;
+    pthread_mutex_unlock(&queue->mutex);
+    
+    dequeue_batch(queue, max_count, NULL);
+    int result = apply_batch(queue);
+    
+    pthread_mutex_lock(&queue->mutex);
+    queue->is_applying = false;
+    pthread_cond_broadcast(&queue->applied);
+    pthread_mutex_unlock(&queue->mutex);
+    
+    return result;
+}
+
+
+int
+stringset_queue_flush(struct stringset_queue *queue)
+{
+    if (!queue) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    struct barrier barrier = { false };
+    struct node *node = alloc_node(change_barrier, "");
+    if (!node) return -1;
+    node->barrier = &barrier;
+    push(queue, node);
+    
+    int result = 0;
+    pthread_mutex_lock(&queue->mutex);
+    while (!barrier.is_applied && -1 != result) {
+        if (queue->is_applying) {
+            pthread_cond_wait(&queue->applied, &queue->mutex);
+            continue;
+        }
+        
+        queue->is_applying = true;
+        pthread_mutex_unlock(&queue->mutex);
+        
+        dequeue_batch(queue, INT_MAX, &barrier);
+        result = apply_batch(queue);
+        if (-1 == result) remove_barrier(queue, &barrier);
+        
+        pthread_mutex_lock(&queue->mutex);
+        queue->is_applying = false;
+        pthread_cond_broadcast(&queue->applied);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    
+    return -1 == result ? -1 : 0;
+}
+
+
+int
+stringset_queue_remove(struct stringset_queue *queue, char const *string)
+{
+    return enqueue(queue, change_remove, string);
+}
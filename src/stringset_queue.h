@@ -0,0 +1,67 @@
+#ifndef STRINGSET_QUEUE_H_INCLUDED
+#define STRINGSET_QUEUE_H_INCLUDED
+
+
+#include "stringset.h"
+
+
+// A string set queue collects adds and removes for one string set from many
+// producer threads.  Producers enqueue changes without taking a lock; the
+// changes are applied later in batches.  Each batch is deduplicated, keeping
+// the last change to each member, and applied to the string set with one
+// merge pass by `stringset_apply_delta()'.
+//
+// Changes are applied by only one thread at a time, either a thread calling
+// `stringset_queue_apply()' or a thread waiting in `stringset_queue_flush()'.
+// Other threads must not use the string set while changes are applied.
+struct stringset_queue;
+
+
+/****************************
+ * Creation and destruction *
+ ****************************/
+
+// Allocate a queue of changes to `stringset'.
+struct stringset_queue *
+stringset_queue_alloc(struct stringset *stringset);
+
+// Discard the changes not yet applied and free an allocated queue.  No other
+// thread may use the queue.
+void
+stringset_queue_free(struct stringset_queue *queue);
+
+
+/*******************
+ * Enqueue changes *
+ *******************/
+
+// Enqueue adding a string to the string set.  The string is copied.  Safe to
+// call from any number of threads at once.
+int
+stringset_queue_add(struct stringset_queue *queue, char const *string);
+
+// Enqueue removing a string from the string set.  Safe to call from any number
+// of threads at once.
+int
+stringset_queue_remove(struct stringset_queue *queue, char const *string);
+
+
+/*****************
+ * Apply changes *
+ *****************/
+
+// Apply up to `max_count' enqueued changes to the string set in one batch
+// and return the number applied, or -1 on error.  If the batch can't be
+// applied, its changes are kept and applied first by the next call.  Waits
+// if another thread is applying changes.
+int
+stringset_queue_apply(struct stringset_queue *queue, int max_count);
+
+// Wait until every change enqueued before the call, by any thread, has been
+// applied to the string set.  Applies the changes itself when no other thread
+// is applying changes.
+int
+stringset_queue_flush(struct stringset_queue *queue);
+
+
+#endif
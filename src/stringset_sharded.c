@@ -0,0 +1,324 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "stringset_sharded.h"
+#include "stringset_hash.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+
+// Shards are aligned to cache lines so that threads locking neighboring
+// shards don't contend for the same line.
+#define CACHE_LINE_SIZE 64
+
+
+struct shard {
+    pthread_rwlock_t lock;
+    struct stringset *stringset;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+
+struct stringset_sharded {
+    struct shard *shards;
+    int shard_count;
+    enum stringset_order order;
+};
+
+
+// An operation that allocates a shard of a result from shards of the
+// operands.
+typedef struct stringset *
+(*shard_operation)(struct stringset const *first,
+                   struct stringset const *second);
+
+
+static struct shard *
+find_shard(struct stringset_sharded *sharded, char const *string)
+{
+    uint64_t hash = mix_hash(hash_string(sharded->order, string)) >> 32;
+    return &sharded->shards[(hash * (uint64_t)sharded->shard_count) >> 32];
+}
+
+
+// Allocate a sharded string set whose shards have no string sets yet.
+static struct stringset_sharded *
+alloc_sharded(int shard_count, enum stringset_order order)
+{
+    size_t size = sizeof(struct stringset_sharded);
+    struct stringset_sharded *sharded = calloc(1, size);
+    if (!sharded) return NULL;
+    
+    void *shards;
+    int result = posix_memalign(&shards,
+                                CACHE_LINE_SIZE,
+                                sizeof(struct shard) * (size_t)shard_count);
+    if (result) {
+        free(sharded);
+        errno = result;
+        return NULL;
+    }
+    sharded->shards = shards;
+    sharded->order = order;
+    
+    for (int i = 0; i < shard_count; ++i) {
+        sharded->shards[i].stringset = NULL;
+        result = pthread_rwlock_init(&sharded->shards[i].lock, NULL);
+        if (result) {
+            stringset_sharded_free(sharded);
+            errno = result;
+            return NULL;
+        }
+        ++sharded->shard_count;
+    }
+    return sharded;
+}
+
+
+// Read lock a shard of each of two sharded string sets, in address order so
+// that threads locking the same pair can't deadlock.
+static void
+lock_pair(struct shard *first, struct shard *second)
+{
+    if (first > second) {
+        struct shard *swapped = first;
+        first = second;
+        second = swapped;
+    }
+    pthread_rwlock_rdlock(&first->lock);
+    if (second != first) pthread_rwlock_rdlock(&second->lock);
+}
+
+
+static void
+unlock_pair(struct shard *first, struct shard *second)
+{
+    if (second != first) pthread_rwlock_unlock(&second->lock);
+    pthread_rwlock_unlock(&first->lock);
+}
+
+
+static struct stringset_sharded *
+alloc_combined(struct stringset_sharded *first,
+               struct stringset_sharded *second,
+               shard_operation operation)
+{
+    if (   !first
+        || !second
+        || first->shard_count != second->shard_count
+        || first->order != second->order)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset_sharded *sharded = alloc_sharded(first->shard_count,
+                                                      first->order);
+    if (!sharded) return NULL;
+    
+    for (int i = 0; i < sharded->shard_count; ++i) {
+        struct shard *first_shard = &first->shards[i];
+        struct shard *second_shard = &second->shards[i];
+        lock_pair(first_shard, second_shard);
+        struct stringset *stringset = operation(first_shard->stringset,
+                                                second_shard->stringset);
+        unlock_pair(first_shard, second_shard);
+        if (!stringset) {
+            stringset_sharded_free(sharded);
+            return NULL;
+        }
+        sharded->shards[i].stringset = stringset;
+    }
+    return sharded;
+}
+
+
+static struct stringset *
+alloc_shard_intersection(struct stringset const *first,
+                         struct stringset const *second)
+{
+    struct stringset const *pair[] = { first, second };
+    return stringset_alloc_intersection_of(pair, 2);
+}
+
+
+static struct stringset *
+alloc_shard_union(struct stringset const *first,
+                  struct stringset const *second)
+{
+    struct stringset const *pair[] = { first, second };
+    return stringset_alloc_union_of(pair, 2);
+}
+
+
+struct stringset_sharded *
+stringset_sharded_alloc(int shard_count,
+                        struct stringset_options const *options)
+{
+    if (shard_count < 1 || (options && options->pool)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    enum stringset_order order = options ? options->order
+                                         : stringset_order_lexical;
+    struct stringset_sharded *sharded = alloc_sharded(shard_count, order);
+    if (!sharded) return NULL;
+    
+    for (int i = 0; i < shard_count; ++i) {
+        sharded->shards[i].stringset = stringset_alloc_with_options(options);
+        if (!sharded->shards[i].stringset) {
+            stringset_sharded_free(sharded);
+            return NULL;
+        }
+    }
+    return sharded;
+}
+
+
+struct stringset_sharded *
+stringset_sharded_alloc_difference(struct stringset_sharded *first,
+                                   struct stringset_sharded *second)
+{
+    return alloc_combined(first, second, stringset_alloc_difference);
+}
+
+
+struct stringset_sharded *
+stringset_sharded_alloc_intersection(struct stringset_sharded *first,
+                                     struct stringset_sharded *second)
+{
+    return alloc_combined(first, second, alloc_shard_intersection);
+}
+
+
+struct stringset *
+stringset_sharded_alloc_stringset(struct stringset_sharded *sharded)
+{
+    if (!sharded) {
+        errno = EINVAL;
+        return NULL;
+    }
+    
+    struct stringset const **stringsets = malloc(sizeof(struct stringset *)
+                                                 * sharded->shard_count);
+    if (!stringsets) return NULL;
+    
+    for (int i = 0; i < sharded->shard_count; ++i) {
+        pthread_rwlock_rdlock(&sharded->shards[i].lock);
+        stringsets[i] = sharded->shards[i].stringset;
+    }
+    int count = sharded->shard_count;
+    struct stringset *stringset = stringset_alloc_union_of(stringsets, count);
+    for (int i = sharded->shard_count - 1; i >= 0; --i) {
+        pthread_rwlock_unlock(&sharded->shards[i].lock);
+    }
+    
+    free(stringsets);
+    return stringset;
+}
+
+
+struct stringset_sharded *
+stringset_sharded_alloc_union(struct stringset_sharded *first,
+                              struct stringset_sharded *second)
+{
+    return alloc_combined(first, second, alloc_shard_union);
+}
+
+
+void
+stringset_sharded_free(struct stringset_sharded *sharded)
+{
+    if (sharded) {
+        for (int i = 0; i < sharded->shard_count; ++i) {
+            stringset_free(sharded->shards[i].stringset);
+            pthread_rwlock_destroy(&sharded->shards[i].lock);
+        }
+        free(sharded->shards);
+        free(sharded);
+    }
+}
+
+
+int
+stringset_sharded_add(struct stringset_sharded *sharded, char const *string)
+{
+    if (!sharded || !string) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    struct shard *shard = find_shard(sharded, string);
+    pthread_rwlock_wrlock(&shard->lock);
+    int result = stringset_add(shard->stringset, string);
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+
+bool
+stringset_sharded_contains(struct stringset_sharded *sharded,
+                           char const *string)
+{
+    if (!sharded || !string) {
+        errno = EINVAL;
+        return false;
+    }
+    
+    struct shard *shard = find_shard(sharded, string);
+    pthread_rwlock_rdlock(&shard->lock);
+    bool contains = stringset_contains(shard->stringset, string);
+    pthread_rwlock_unlock(&shard->lock);
+    return contains;
+}
+
+
+size_t
+stringset_sharded_count(struct stringset_sharded *sharded)
+{
+    if (!sharded) {
+        errno = EINVAL;
+        return 0;
+    }
+    
+    size_t count = 0;
+    for (int i = 0; i < sharded->shard_count; ++i) {
+        pthread_rwlock_rdlock(&sharded->shards[i].lock);
+        count += sharded->shards[i].stringset->count;
+        pthread_rwlock_unlock(&sharded->shards[i].lock);
+    }
+    return count;
+}
+
+
+int
+stringset_sharded_remove(struct stringset_sharded *sharded,
+                         char const *string)
+{
+    if (!sharded || !string) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    struct shard *shard = find_shard(sharded, string);
+    pthread_rwlock_wrlock(&shard->lock);
+    int result = stringset_remove(shard->stringset, string);
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+
+int
+stringset_sharded_shard_count(struct stringset_sharded const *sharded)
+{
+    if (!sharded) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    return sharded->shard_count;
+}
@@ -0,0 +1,95 @@
+#ifndef STRINGSET_SHARDED_H_INCLUDED
+#define STRINGSET_SHARDED_H_INCLUDED
+
+
+#include <stdbool.h>
+
+#include "stringset.h"
+
+
+// A sharded string set partitions its members by hash among a fixed number of
+// string sets, the shards, each guarded by its own reader-writer lock.  Any
+// number of threads may add, remove and test members at once; threads only
+// wait for each other when they use the same shard and one of them changes
+// it.  Members aren't kept in one sorted array; allocate a string set with
+// `stringset_sharded_alloc_stringset()' for a sorted view.
+struct stringset_sharded;
+
+
+/****************************
+ * Creation and destruction *
+ ****************************/
+
+// Allocate an empty sharded string set with `shard_count' shards.  The shards
+// are allocated with `options', which may be NULL for the defaults.  An
+// allocator in `options' must be thread safe; `options->pool' must be NULL,
+// since interning pools aren't thread safe.
+struct stringset_sharded *
+stringset_sharded_alloc(int shard_count,
+                        struct stringset_options const *options);
+
+// Allocate a string set with the members of a sharded string set, sorted in
+// its order.  Each shard is read locked while the shards are merged, so
+// changes made at the same time may or may not be included.
+struct stringset *
+stringset_sharded_alloc_stringset(struct stringset_sharded *sharded);
+
+// Delete all members and free an allocated sharded string set.  No other
+// thread may use it.
+void
+stringset_sharded_free(struct stringset_sharded *sharded);
+
+
+/*******************
+ * Test membership *
+ *******************/
+
+// The number of members of a sharded string set.  Shards are counted one at a
+// time, so the count may be inexact while other threads change the set.
+size_t
+stringset_sharded_count(struct stringset_sharded *sharded);
+
+bool
+stringset_sharded_contains(struct stringset_sharded *sharded,
+                           char const *string);
+
+// The number of shards of a sharded string set.
+int
+stringset_sharded_shard_count(struct stringset_sharded const *sharded);
+
+
+/**********************
+ * Add/remove members *
+ **********************/
+
+int
+stringset_sharded_add(struct stringset_sharded *sharded, char const *string);
+
+int
+stringset_sharded_remove(struct stringset_sharded *sharded,
+                         char const *string);
+
+
+/******************
+ * Set operations *
+ ******************/
+
+// The set operations work shard by shard, since the same member is always in
+// the same shard of sharded string sets with the same shard count and order.
+// They set `errno' to `EINVAL' for sharded string sets with different shard
+// counts or orders.  The result has the options of `first'.
+
+struct stringset_sharded *
+stringset_sharded_alloc_difference(struct stringset_sharded *first,
+                                   struct stringset_sharded *second);
+
+struct stringset_sharded *
+stringset_sharded_alloc_intersection(struct stringset_sharded *first,
+                                     struct stringset_sharded *second);
+
+struct stringset_sharded *
+stringset_sharded_alloc_union(struct stringset_sharded *first,
+                              struct stringset_sharded *second);
+
+
+#endif
@@ -119,15 +119,24 @@ test_members_are_sorted(void)
 void
 test_add_array(void);
 
+void
+test_add_sorted_array(void);
+
 void
 test_add_stringset(void);
 
 void
 test_add_stringset_remove_common(void);
 
+void
+test_alloc_delta(void);
+
 void
 test_alloc_difference(void);
 
+void
+test_alloc_from_stringset(void);
+
 void
 test_alloc_intersection(void);
 
@@ -137,9 +146,45 @@ test_alloc_symmetric_difference(void);
 void
 test_alloc_union(void);
 
+void
+test_alloc_with_allocator(void);
+
+void
+test_alloc_with_options(void);
+
+void
+test_apply_delta(void);
+
+void
+test_build_filter(void);
+
+void
+test_build_index(void);
+
+void
+test_sketch_estimate(void);
+
+void
+test_count_operations(void);
+
+void
+test_alloc_union_of(void);
+
 void
 test_clear(void);
 
+void
+test_concurrent(void);
+
+void
+test_external(void);
+
+void
+test_for_each(void);
+
+void
+test_persistent(void);
+
 void
 test_is_disjoint_from(void);
 
@@ -158,6 +203,12 @@ test_is_subset_of(void);
 void
 test_is_superset_of(void);
 
+void
+test_pool(void);
+
+void
+test_queue(void);
+
 void
 test_remove(void);
 
@@ -173,6 +224,24 @@ test_retain_array(void);
 void
 test_retain_stringset(void);
 
+void
+test_serialize(void);
+
+void
+test_set_deferred(void);
+
+void
+test_sharded(void);
+
+void
+test_short_strings(void);
+
+void
+test_stats(void);
+
+void
+test_trace(void);
+
 
 int
 main(int argc, char *argv[])
@@ -184,24 +253,47 @@ main(int argc, char *argv[])
     test_members_are_sorted();
     
     test_add_array();
+    test_add_sorted_array();
     test_add_stringset();
     test_add_stringset_remove_common();
+    test_alloc_delta();
     test_alloc_difference();
+    test_alloc_from_stringset();
     test_alloc_intersection();
     test_alloc_symmetric_difference();
     test_alloc_union();
+    test_alloc_with_allocator();
+    test_alloc_with_options();
+    test_apply_delta();
+    test_build_filter();
+    test_build_index();
+    test_sketch_estimate();
+    test_count_operations();
+    test_alloc_union_of();
     test_clear();
+    test_concurrent();
+    test_external();
+    test_for_each();
+    test_persistent();
     test_is_disjoint_from();
     test_is_equal_to();
     test_is_proper_subset_of();
     test_is_proper_superset_of();
     test_is_subset_of();
     test_is_superset_of();
+    test_pool();
+    test_queue();
     test_remove();
     test_remove_array();
     test_remove_stringset();
     test_retain_array();
     test_retain_stringset();
+    test_serialize();
+    test_set_deferred();
+    test_sharded();
+    test_short_strings();
+    test_stats();
+    test_trace();
     
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,160 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+#define STRINGS_COUNT 1000
+
+
+static char **
+alloc_numbers(void)
+{
+    char **strings = malloc(sizeof(char *) * STRINGS_COUNT);
+    assert(strings);
+    for (int i = 0; i < STRINGS_COUNT; ++i) {
+        strings[i] = malloc(16);
+        assert(strings[i]);
+        snprintf(strings[i], 16, "%04i", i);
+    }
+    return strings;
+}
+
+
+static void
+free_numbers(char **strings)
+{
+    for (int i = 0; i < STRINGS_COUNT; ++i) free(strings[i]);
+    free(strings);
+}
+
+
+static void
+assert_numbers(struct stringset const *stringset, int count)
+{
+    assert((size_t)count == stringset->count);
+    for (int i = 0; i < count; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        assert(0 == strcmp(string, stringset->members[i]));
+    }
+}
+
+
+static void
+test_add_presorted_arrays(void)
+{
+    char **strings = alloc_numbers();
+    char const **array = malloc(sizeof(char *) * 2 * STRINGS_COUNT);
+    assert(array);
+    
+    // Sorted
+    memcpy(array, strings, sizeof(char *) * STRINGS_COUNT);
+    struct stringset *stringset = stringset_alloc_from_array(array,
+                                                             STRINGS_COUNT);
+    assert(stringset);
+    assert_numbers(stringset, STRINGS_COUNT);
+    stringset_free(stringset);
+    
+    // Reversed
+    for (int i = 0; i < STRINGS_COUNT; ++i) {
+        array[i] = strings[STRINGS_COUNT - 1 - i];
+    }
+    stringset = stringset_alloc_from_array(array, STRINGS_COUNT);
+    assert(stringset);
+    assert_numbers(stringset, STRINGS_COUNT);
+    stringset_free(stringset);
+    
+    // Interleaved sorted runs with duplicates
+    for (int i = 0; i < STRINGS_COUNT; ++i) {
+        array[i] = strings[(i % 200) * 5 + i / 200];
+        array[STRINGS_COUNT + i] = strings[i];
+    }
+    stringset = stringset_alloc_from_array(array, 2 * STRINGS_COUNT);
+    assert(stringset);
+    assert_numbers(stringset, STRINGS_COUNT);
+    stringset_free(stringset);
+    
+    // Shuffled, with too many runs to merge
+    for (int i = 0; i < STRINGS_COUNT; ++i) {
+        array[i] = strings[(i * 7) % STRINGS_COUNT];
+    }
+    stringset = stringset_alloc_from_array(array, STRINGS_COUNT);
+    assert(stringset);
+    assert_numbers(stringset, STRINGS_COUNT);
+    
+    // Merged into existing members
+    stringset_free(stringset);
+    stringset = stringset_alloc();
+    assert(stringset);
+    int result = stringset_build_filter(stringset, 0.01);
+    assert(0 == result);
+    result = stringset_add_array(stringset,
+                                 (char const *const *)strings + 500,
+                                 500);
+    assert(0 == result);
+    result = stringset_add_array(stringset, array, STRINGS_COUNT);
+    assert(0 == result);
+    assert_numbers(stringset, STRINGS_COUNT);
+    assert(stringset_contains(stringset, "0042"));
+    assert(stringset_contains(stringset, "0999"));
+    stringset_free(stringset);
+    
+    free(array);
+    free_numbers(strings);
+}
+
+
+static void
+test_add_sorted_arrays(void)
+{
+    char **strings = alloc_numbers();
+    
+    struct stringset *stringset = stringset_alloc_from_sorted_array(
+        (char const *const *)strings,
+        STRINGS_COUNT);
+    assert(stringset);
+    assert_numbers(stringset, STRINGS_COUNT);
+    
+    struct stringset *evens = stringset_alloc();
+    assert(evens);
+    for (int i = 0; i < STRINGS_COUNT; i += 2) {
+        int result = stringset_add(evens, strings[i]);
+        assert(0 == result);
+    }
+    int result = stringset_add_sorted_array(evens,
+                                            (char const *const *)strings,
+                                            STRINGS_COUNT);
+    assert(0 == result);
+    assert(stringset_is_equal_to(stringset, evens));
+    stringset_free(evens);
+    
+    char const *unsorted[] = { "a", "c", "b" };
+    errno = 0;
+    assert(-1 == stringset_add_sorted_array(stringset, unsorted, 3));
+    assert(EINVAL == errno);
+    char const *duplicates[] = { "a", "b", "b" };
+    errno = 0;
+    assert(-1 == stringset_add_sorted_array(stringset, duplicates, 3));
+    assert(EINVAL == errno);
+    assert_numbers(stringset, STRINGS_COUNT);
+    
+    char const *with_null[] = { "a", NULL };
+    errno = 0;
+    assert(-1 == stringset_add_array(stringset, with_null, 2));
+    assert(EINVAL == errno);
+    
+    stringset_free(stringset);
+    free_numbers(strings);
+}
+
+
+void
+test_add_sorted_array(void)
+{
+    test_add_presorted_arrays();
+    test_add_sorted_arrays();
+}
@@ -31,6 +31,30 @@ test_add_stringset_remove_common(void)
     assert(0 == strcmp("strawberry", set1->members[2]));
     assert(0 == strcmp("watermelon", set1->members[3]));
     
+    char const *members3[] = {
+        "zucchini", "apple", "cherry", "aardvark"
+    };
+    int members3_count = sizeof members3 / sizeof members3[0];
+    struct stringset *set3 = stringset_alloc_from_array(members3, members3_count);
+    assert(set3);
+    
+    result = stringset_add_stringset_remove_common(set1, set3);
+    assert(0 == result);
+    
+    assert(6 == set1->count);
+    
+    assert(0 == strcmp("aardvark", set1->members[0]));
+    assert(0 == strcmp("cherry", set1->members[1]));
+    assert(0 == strcmp("green", set1->members[2]));
+    assert(0 == strcmp("strawberry", set1->members[3]));
+    assert(0 == strcmp("watermelon", set1->members[4]));
+    assert(0 == strcmp("zucchini", set1->members[5]));
+    
+    result = stringset_add_stringset_remove_common(set1, set1);
+    assert(0 == result);
+    assert(0 == set1->count);
+    
+    stringset_free(set3);
     stringset_free(set1);
     stringset_free(set2);
 }
@@ -0,0 +1,63 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+void
+test_alloc_delta(void)
+{
+    char const *members1[] = {
+        "watermelon", "mango", "apple", "banana", "strawberry"
+    };
+    int members1_count = sizeof members1 / sizeof members1[0];
+    struct stringset *set1 = stringset_alloc_from_array(members1, members1_count);
+    assert(set1);
+    
+    char const *members2[] = {
+        "watermelon", "apple", "strawberries", "strawberry", "blueberry"
+    };
+    int members2_count = sizeof members2 / sizeof members2[0];
+    struct stringset *set2 = stringset_alloc_from_array(members2, members2_count);
+    assert(set2);
+    
+    struct stringset_delta *delta = stringset_alloc_delta(set1, set2);
+    assert(delta);
+    
+    assert(2 == delta->added->count);
+    assert(0 == strcmp("blueberry", delta->added->members[0]));
+    assert(0 == strcmp("strawberries", delta->added->members[1]));
+    
+    assert(2 == delta->removed->count);
+    assert(0 == strcmp("banana", delta->removed->members[0]));
+    assert(0 == strcmp("mango", delta->removed->members[1]));
+    
+    size_t size;
+    void *bytes = stringset_delta_serialize(delta, &size);
+    assert(bytes);
+    assert(size < strlen("blueberrystrawberriesbananamango") + 16);
+    
+    struct stringset_delta *copy = stringset_alloc_delta_from_bytes(bytes, size);
+    assert(copy);
+    assert(stringset_is_equal_to(delta->added, copy->added));
+    assert(stringset_is_equal_to(delta->removed, copy->removed));
+    stringset_delta_free(copy);
+    
+    copy = stringset_alloc_delta_from_bytes(bytes, size - 1);
+    assert(!copy);
+    assert(EINVAL == errno);
+    
+    free(bytes);
+    stringset_delta_free(delta);
+    
+    delta = stringset_alloc_delta(set1, set1);
+    assert(delta);
+    assert(0 == delta->added->count);
+    assert(0 == delta->removed->count);
+    stringset_delta_free(delta);
+    
+    stringset_free(set1);
+    stringset_free(set2);
+}
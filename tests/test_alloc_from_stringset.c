@@ -0,0 +1,248 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+static struct stringset *
+alloc_fruits(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    char const *members[] = { "cherry", "apple", "banana", "date" };
+    int result = stringset_add_array(set, members, 4);
+    assert(0 == result);
+    return set;
+}
+
+
+static void
+test_alloc_from_stringset_shares_members(void)
+{
+    struct stringset *set = alloc_fruits();
+    struct stringset *clone = stringset_alloc_from_stringset(set);
+    assert(clone);
+    assert(set->members == clone->members);
+    assert(4 == clone->count);
+    assert(stringset_is_equal_to(set, clone));
+    
+    int result = stringset_add(clone, "apple");
+    assert(0 == result);
+    result = stringset_remove(clone, "fig");
+    assert(0 == result);
+    assert(set->members == clone->members);
+    
+    result = stringset_add(clone, "elderberry");
+    assert(0 == result);
+    assert(set->members != clone->members);
+    assert(4 == set->count);
+    assert(5 == clone->count);
+    assert(!stringset_contains(set, "elderberry"));
+    for (size_t i = 0; i < set->count; ++i) {
+        assert(set->members[i] == clone->members[i]);
+    }
+    
+    stringset_free(set);
+    assert(0 == strcmp("apple", clone->members[0]));
+    assert(0 == strcmp("elderberry", clone->members[4]));
+    stringset_free(clone);
+}
+
+
+static void
+test_alloc_from_stringset_mutate_source(void)
+{
+    struct stringset *set = alloc_fruits();
+    struct stringset *first = stringset_alloc_from_stringset(set);
+    struct stringset *second = stringset_alloc_from_stringset(first);
+    assert(first && second);
+    assert(set->members == second->members);
+    
+    int result = stringset_remove(set, "banana");
+    assert(0 == result);
+    assert(3 == set->count);
+    assert(4 == first->count);
+    assert(stringset_contains(second, "banana"));
+    
+    char const *retained[] = { "apple", "date" };
+    result = stringset_retain_array(first, retained, 2);
+    assert(0 == result);
+    assert(2 == first->count);
+    assert(4 == second->count);
+    
+    result = stringset_clear(second);
+    assert(0 == result);
+    assert(0 == second->count);
+    assert(2 == first->count);
+    assert(3 == set->count);
+    
+    stringset_free(first);
+    stringset_free(second);
+    stringset_free(set);
+}
+
+
+static void
+test_alloc_from_stringset_deferred(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    result = stringset_add(set, "beta");
+    assert(0 == result);
+    result = stringset_add(set, "alpha");
+    assert(0 == result);
+    
+    struct stringset *clone = stringset_alloc_from_stringset(set);
+    assert(clone);
+    assert(2 == clone->count);
+    assert(0 == strcmp("alpha", clone->members[0]));
+    
+    result = stringset_add(set, "gamma");
+    assert(0 == result);
+    assert(stringset_contains(set, "gamma"));
+    assert(!stringset_contains(clone, "gamma"));
+    
+    stringset_free(clone);
+    stringset_free(set);
+}
+
+
+#define CLONING_THREADS_COUNT 4
+#define CLONES_COUNT 1000
+
+
+static void *
+clone_repeatedly(void *context)
+{
+    struct stringset const *set = context;
+    for (int i = 0; i < CLONES_COUNT; ++i) {
+        struct stringset *clone = stringset_alloc_from_stringset(set);
+        assert(clone);
+        assert(set->members == clone->members);
+        stringset_free(clone);
+    }
+    return NULL;
+}
+
+
+static void
+test_alloc_from_stringset_on_threads(void)
+{
+    struct stringset *set = alloc_fruits();
+    pthread_t threads[CLONING_THREADS_COUNT];
+    for (int i = 0; i < CLONING_THREADS_COUNT; ++i) {
+        int result = pthread_create(&threads[i], NULL, clone_repeatedly, set);
+        assert(0 == result);
+    }
+    for (int i = 0; i < CLONING_THREADS_COUNT; ++i) {
+        int result = pthread_join(threads[i], NULL);
+        assert(0 == result);
+    }
+    
+    struct stringset *clone = stringset_alloc_from_stringset(set);
+    assert(clone);
+    int result = stringset_add(set, "elderberry");
+    assert(0 == result);
+    assert(set->members != clone->members);
+    assert(4 == clone->count);
+    
+    stringset_free(set);
+    assert(0 == strcmp("apple", clone->members[0]));
+    stringset_free(clone);
+}
+
+
+#define SNAPSHOT_THREADS_COUNT 4
+#define SNAPSHOT_ROUNDS_COUNT 50
+#define SNAPSHOT_MEMBERS_COUNT 200
+
+
+// Short strings are kept in slab slots and long ones allocated one by one,
+// so members alternate between the two.
+static void
+format_member(char *string, size_t size, int number)
+{
+    char const *format = number % 2 ? "%d" : "a long member string number %d";
+    snprintf(string, size, format, number);
+}
+
+
+static void *
+mutate_snapshot(void *context)
+{
+    struct stringset *snapshot = context;
+    for (int i = 0; i < SNAPSHOT_MEMBERS_COUNT; i += 2) {
+        char string[64];
+        format_member(string, sizeof string, i);
+        int result = stringset_remove(snapshot, string);
+        assert(0 == result);
+        format_member(string, sizeof string, -i);
+        result = stringset_add(snapshot, string);
+        assert(0 == result);
+    }
+    stringset_free(snapshot);
+    return NULL;
+}
+
+
+// Snapshots of a string set share its member strings, which are released
+// and reused on several threads at once.
+static void
+test_alloc_from_stringset_snapshots_on_threads(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    char string[64];
+    for (int i = 0; i < SNAPSHOT_MEMBERS_COUNT; ++i) {
+        format_member(string, sizeof string, i);
+        int result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    
+    for (int round = 0; round < SNAPSHOT_ROUNDS_COUNT; ++round) {
+        pthread_t threads[SNAPSHOT_THREADS_COUNT];
+        for (int i = 0; i < SNAPSHOT_THREADS_COUNT; ++i) {
+            struct stringset *snapshot = stringset_alloc_from_stringset(set);
+            assert(snapshot);
+            int result = pthread_create(&threads[i],
+                                        NULL,
+                                        mutate_snapshot,
+                                        snapshot);
+            assert(0 == result);
+        }
+        
+        // Replace each member with an equal copy while the snapshots are
+        // mutated and freed.
+        for (int i = 0; i < SNAPSHOT_MEMBERS_COUNT; ++i) {
+            format_member(string, sizeof string, i);
+            int result = stringset_remove(set, string);
+            assert(0 == result);
+            result = stringset_add(set, string);
+            assert(0 == result);
+        }
+        
+        for (int i = 0; i < SNAPSHOT_THREADS_COUNT; ++i) {
+            int result = pthread_join(threads[i], NULL);
+            assert(0 == result);
+        }
+        assert(SNAPSHOT_MEMBERS_COUNT == set->count);
+    }
+    
+    stringset_free(set);
+}
+
+
+void
+test_alloc_from_stringset(void)
+{
+    test_alloc_from_stringset_shares_members();
+    test_alloc_from_stringset_mutate_source();
+    test_alloc_from_stringset_deferred();
+    test_alloc_from_stringset_on_threads();
+    test_alloc_from_stringset_snapshots_on_threads();
+}
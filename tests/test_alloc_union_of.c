@@ -0,0 +1,91 @@
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+void
+test_alloc_union_of(void)
+{
+    char const *members1[] = {
+        "watermelon", "mango", "apple", "banana", "strawberry"
+    };
+    int members1_count = sizeof members1 / sizeof members1[0];
+    struct stringset *set1 = stringset_alloc_from_array(members1, members1_count);
+    assert(set1);
+    
+    char const *members2[] = {
+        "mango", "green", "banana"
+    };
+    int members2_count = sizeof members2 / sizeof members2[0];
+    struct stringset *set2 = stringset_alloc_from_array(members2, members2_count);
+    assert(set2);
+    
+    char const *members3[] = {
+        "banana", "apple", "zucchini", "mango"
+    };
+    int members3_count = sizeof members3 / sizeof members3[0];
+    struct stringset *set3 = stringset_alloc_from_array(members3, members3_count);
+    assert(set3);
+    
+    struct stringset *empty = stringset_alloc();
+    assert(empty);
+    
+    struct stringset const *sets[] = { set1, set2, set3, empty };
+    
+    struct stringset *result = stringset_alloc_union_of(sets, 4);
+    assert(result);
+    assert(7 == result->count);
+    assert(0 == strcmp("apple", result->members[0]));
+    assert(0 == strcmp("banana", result->members[1]));
+    assert(0 == strcmp("green", result->members[2]));
+    assert(0 == strcmp("mango", result->members[3]));
+    assert(0 == strcmp("strawberry", result->members[4]));
+    assert(0 == strcmp("watermelon", result->members[5]));
+    assert(0 == strcmp("zucchini", result->members[6]));
+    stringset_free(result);
+    
+    result = stringset_alloc_intersection_of(sets, 3);
+    assert(result);
+    assert(2 == result->count);
+    assert(0 == strcmp("banana", result->members[0]));
+    assert(0 == strcmp("mango", result->members[1]));
+    stringset_free(result);
+    
+    result = stringset_alloc_intersection_of(sets, 4);
+    assert(result);
+    assert(0 == result->count);
+    stringset_free(result);
+    
+    result = stringset_alloc_at_least(sets, 3, 2);
+    assert(result);
+    assert(3 == result->count);
+    assert(0 == strcmp("apple", result->members[0]));
+    assert(0 == strcmp("banana", result->members[1]));
+    assert(0 == strcmp("mango", result->members[2]));
+    stringset_free(result);
+    
+    result = stringset_alloc_at_least(sets, 3, 3);
+    assert(result);
+    assert(2 == result->count);
+    stringset_free(result);
+    
+    struct stringset const *same[] = { set2, set2 };
+    result = stringset_alloc_union_of(same, 2);
+    assert(result);
+    assert(stringset_is_equal_to(result, set2));
+    stringset_free(result);
+    
+    errno = 0;
+    assert(!stringset_alloc_union_of(sets, 0));
+    assert(EINVAL == errno);
+    assert(!stringset_alloc_at_least(sets, 3, 4));
+    struct stringset const *null_sets[] = { set1, NULL };
+    assert(!stringset_alloc_intersection_of(null_sets, 2));
+    
+    stringset_free(set1);
+    stringset_free(set2);
+    stringset_free(set3);
+    stringset_free(empty);
+}
@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+struct counts {
+    int allocations;
+    int deallocations;
+};
+
+
+static void *
+counting_allocate(size_t size, void *context)
+{
+    struct counts *counts = context;
+    ++counts->allocations;
+    return malloc(size);
+}
+
+
+static void *
+counting_reallocate(void *memory, size_t size, void *context)
+{
+    struct counts *counts = context;
+    if (!memory) ++counts->allocations;
+    return realloc(memory, size);
+}
+
+
+static void
+counting_deallocate(void *memory, void *context)
+{
+    struct counts *counts = context;
+    if (memory) ++counts->deallocations;
+    free(memory);
+}
+
+
+struct arena {
+    unsigned char bytes[16 * 1024];
+    size_t size;
+};
+
+
+static void *
+arena_allocate(size_t size, void *context)
+{
+    struct arena *arena = context;
+    size_t aligned_size = (size + 15) & ~(size_t)15;
+    if (arena->size + aligned_size > sizeof arena->bytes) return NULL;
+    
+    void *memory = arena->bytes + arena->size;
+    arena->size += aligned_size;
+    return memory;
+}
+
+
+static void
+test_counting_allocator(void)
+{
+    struct counts counts = { 0, 0 };
+    struct stringset_allocator allocator = {
+        counting_allocate, counting_reallocate, counting_deallocate, &counts
+    };
+    struct stringset *set = stringset_alloc_with_allocator(&allocator);
+    assert(set);
+    
+    char const *members[] = {
+        "watermelon", "mango", "apple", "banana", "strawberry"
+    };
+    int members_count = sizeof members / sizeof members[0];
+    int allocations = counts.allocations;
+    int result = stringset_add_array(set, members, members_count);
+    assert(0 == result);
+    
+    // The short members share a slab rather than taking an allocation each.
+    assert(counts.allocations - allocations < members_count);
+    
+    result = stringset_remove(set, "mango");
+    assert(0 == result);
+    
+    struct stringset *copy = stringset_alloc_from_stringset(set);
+    assert(copy);
+    assert(4 == copy->count);
+    
+    result = stringset_set_deferred(copy, true);
+    assert(0 == result);
+    result = stringset_add(copy, "kiwi");
+    assert(0 == result);
+    
+    stringset_free(copy);
+    stringset_free(set);
+    assert(counts.allocations == counts.deallocations);
+}
+
+
+static void
+test_arena_allocator(void)
+{
+    struct arena *arena = calloc(1, sizeof(struct arena));
+    assert(arena);
+    struct stringset_allocator allocator = { arena_allocate, NULL, NULL, arena };
+    struct stringset *set = stringset_alloc_with_allocator(&allocator);
+    assert(set);
+    
+    for (int i = 0; i < 100; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%03i", 99 - i);
+        int result = stringset_add(set, string);
+        assert(0 == result);
+        
+        uintptr_t address = (uintptr_t)set->members[set->count - 1];
+        assert(address >= (uintptr_t)arena->bytes);
+        assert(address < (uintptr_t)arena->bytes + sizeof arena->bytes);
+    }
+    assert(100 == set->count);
+    assert(0 == strcmp("000", set->members[0]));
+    assert(0 == strcmp("099", set->members[99]));
+    
+    int result = stringset_remove(set, "050");
+    assert(0 == result);
+    result = stringset_compact(set);
+    assert(0 == result);
+    assert(99 == set->count);
+    assert(stringset_contains(set, "049"));
+    assert(!stringset_contains(set, "050"));
+    
+    result = stringset_clear(set);
+    assert(0 == result);
+    assert(0 == set->count);
+    
+    stringset_free(set);
+    free(arena);
+}
+
+
+void
+test_alloc_with_allocator(void)
+{
+    test_counting_allocator();
+    test_arena_allocator();
+}
@@ -0,0 +1,255 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+static struct stringset *
+alloc_with_order(enum stringset_order order)
+{
+    struct stringset_options options = { NULL, order, NULL, false, false };
+    struct stringset *set = stringset_alloc_with_options(&options);
+    assert(set);
+    assert(order == set->order);
+    
+    char const *members[] = {
+        "banana", "Apple", "fig", "apple", "cherry", "Fig"
+    };
+    int members_count = sizeof members / sizeof members[0];
+    int result = stringset_add_array(set, members, members_count);
+    assert(0 == result);
+    return set;
+}
+
+
+static void
+test_alloc_with_options_case_folded(void)
+{
+    struct stringset *set = alloc_with_order(stringset_order_case_folded);
+    assert(4 == set->count);
+    assert(0 == strcmp("Apple", set->members[0]));
+    assert(0 == strcmp("banana", set->members[1]));
+    assert(0 == strcmp("cherry", set->members[2]));
+    assert(0 == strcmp("fig", set->members[3]));
+    assert(stringset_contains(set, "APPLE"));
+    assert(stringset_contains(set, "Banana"));
+    assert(!stringset_contains(set, "date"));
+    
+    int result = stringset_build_filter(set, 0.01);
+    assert(0 == result);
+    assert(stringset_contains(set, "CHERRY"));
+    
+    result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    result = stringset_add(set, "Date");
+    assert(0 == result);
+    result = stringset_add(set, "DATE");
+    assert(0 == result);
+    assert(stringset_contains(set, "date"));
+    assert(5 == set->count);
+    
+    result = stringset_remove(set, "BANANA");
+    assert(0 == result);
+    assert(4 == set->count);
+    assert(0 == strcmp("Date", set->members[2]));
+    
+    struct stringset *copy = stringset_alloc_from_stringset(set);
+    assert(copy);
+    assert(stringset_order_case_folded == copy->order);
+    assert(stringset_is_equal_to(set, copy));
+    
+    stringset_free(copy);
+    stringset_free(set);
+}
+
+
+static void
+test_alloc_with_options_length_first(void)
+{
+    struct stringset *set = alloc_with_order(stringset_order_length_first);
+    assert(6 == set->count);
+    assert(0 == strcmp("Fig", set->members[0]));
+    assert(0 == strcmp("fig", set->members[1]));
+    assert(0 == strcmp("Apple", set->members[2]));
+    assert(0 == strcmp("apple", set->members[3]));
+    assert(0 == strcmp("banana", set->members[4]));
+    assert(0 == strcmp("cherry", set->members[5]));
+    assert(stringset_contains(set, "cherry"));
+    assert(!stringset_contains(set, "Cherry"));
+    
+    stringset_free(set);
+}
+
+
+static void
+test_alloc_with_options_mismatched_orders(void)
+{
+    struct stringset *lexical = alloc_with_order(stringset_order_lexical);
+    struct stringset *folded = alloc_with_order(stringset_order_case_folded);
+    assert(6 == lexical->count);
+    
+    errno = 0;
+    assert(!stringset_alloc_union(lexical, folded));
+    assert(EINVAL == errno);
+    assert(0 == stringset_count_intersection(lexical, folded));
+    assert(-1 == stringset_retain_stringset(lexical, folded));
+    assert(6 == lexical->count);
+    
+    struct stringset const *sets[] = { folded, lexical };
+    assert(!stringset_alloc_union_of(sets, 2));
+    
+    struct stringset_options options = { NULL, 3, NULL, false, false };
+    assert(!stringset_alloc_with_options(&options));
+    
+    stringset_free(lexical);
+    stringset_free(folded);
+}
+
+
+static void
+test_alloc_with_options_delta(void)
+{
+    struct stringset *from = alloc_with_order(stringset_order_length_first);
+    struct stringset *to = alloc_with_order(stringset_order_length_first);
+    int result = stringset_remove(to, "Fig");
+    assert(0 == result);
+    result = stringset_add(to, "kiwi");
+    assert(0 == result);
+    
+    struct stringset_delta *delta = stringset_alloc_delta(from, to);
+    assert(delta);
+    size_t size;
+    void *bytes = stringset_delta_serialize(delta, &size);
+    assert(bytes);
+    struct stringset_delta *copy = stringset_alloc_delta_from_bytes(bytes,
+                                                                    size);
+    assert(copy);
+    assert(stringset_order_length_first == copy->added->order);
+    
+    result = stringset_apply_delta(from, copy);
+    assert(0 == result);
+    assert(stringset_is_equal_to(from, to));
+    
+    free(bytes);
+    stringset_delta_free(copy);
+    stringset_delta_free(delta);
+    stringset_free(from);
+    stringset_free(to);
+}
+
+
+
+static void
+test_alloc_with_options_huge_pages(void)
+{
+    struct stringset_options options = {
+        NULL, stringset_order_lexical, NULL, true, false
+    };
+    struct stringset *set = stringset_alloc_with_options(&options);
+    assert(set);
+    assert(set->uses_huge_pages);
+    
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    for (int i = 0; i < 300000; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%06i", i);
+        result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    result = stringset_set_deferred(set, false);
+    assert(0 == result);
+    assert(300000 == set->count);
+    assert(set->capacity >= set->count);
+    
+    struct stringset *clone = stringset_alloc_from_stringset(set);
+    assert(clone);
+    assert(clone->uses_huge_pages);
+    result = stringset_remove(clone, "000000");
+    assert(0 == result);
+    assert(stringset_contains(set, "000000"));
+    
+    struct stringset *odds = stringset_alloc_with_options(&options);
+    assert(odds);
+    for (int i = 1; i < 1000; i += 2) {
+        char string[16];
+        snprintf(string, sizeof string, "%06i", i);
+        result = stringset_add(odds, string);
+        assert(0 == result);
+    }
+    result = stringset_remove_stringset(set, odds);
+    assert(0 == result);
+    assert(299500 == set->count);
+    result = stringset_add_stringset_remove_common(odds, clone);
+    assert(0 == result);
+    assert(299499 == odds->count);
+    assert(0 == strcmp("000002", odds->members[0]));
+    
+    result = stringset_compact(set);
+    assert(0 == result);
+    assert(stringset_contains(set, "299998"));
+    result = stringset_clear(set);
+    assert(0 == result);
+    assert(!set->members);
+    
+    stringset_free(odds);
+    stringset_free(clone);
+    stringset_free(set);
+}
+
+
+// Explicit huge pages fall back to transparent huge pages when none are
+// reserved, so this passes either way.
+static void
+test_alloc_with_options_explicit_huge_pages(void)
+{
+    struct stringset_options options = {
+        NULL, stringset_order_lexical, NULL, false, true
+    };
+    struct stringset *set = stringset_alloc_with_options(&options);
+    assert(set);
+    assert(set->uses_huge_pages);
+    assert(set->uses_explicit_huge_pages);
+    
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    for (int i = 0; i < 600000; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%06i", i);
+        result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    result = stringset_set_deferred(set, false);
+    assert(0 == result);
+    assert(600000 == set->count);
+    assert(stringset_contains(set, "599999"));
+    
+    struct stringset *clone = stringset_alloc_from_stringset(set);
+    assert(clone);
+    assert(clone->uses_explicit_huge_pages);
+    result = stringset_remove(clone, "000000");
+    assert(0 == result);
+    assert(stringset_contains(set, "000000"));
+    
+    char const *retained[] = { "000001", "000002" };
+    result = stringset_retain_array(set, retained, 2);
+    assert(0 == result);
+    assert(2 == set->count);
+    
+    stringset_free(clone);
+    stringset_free(set);
+}
+
+void
+test_alloc_with_options(void)
+{
+    test_alloc_with_options_case_folded();
+    test_alloc_with_options_length_first();
+    test_alloc_with_options_mismatched_orders();
+    test_alloc_with_options_delta();
+    test_alloc_with_options_huge_pages();
+    test_alloc_with_options_explicit_huge_pages();
+}
@@ -0,0 +1,57 @@
+#include <assert.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+void
+test_apply_delta(void)
+{
+    char const *members1[] = {
+        "watermelon", "mango", "apple", "banana", "strawberry"
+    };
+    int members1_count = sizeof members1 / sizeof members1[0];
+    struct stringset *set1 = stringset_alloc_from_array(members1, members1_count);
+    assert(set1);
+    
+    char const *members2[] = {
+        "watermelon", "apple", "cherry", "strawberry", "blueberry", "zucchini"
+    };
+    int members2_count = sizeof members2 / sizeof members2[0];
+    struct stringset *set2 = stringset_alloc_from_array(members2, members2_count);
+    assert(set2);
+    
+    struct stringset_delta *delta = stringset_alloc_delta(set1, set2);
+    assert(delta);
+    
+    int result = stringset_apply_delta(set1, delta);
+    assert(0 == result);
+    assert(stringset_is_equal_to(set1, set2));
+    
+    assert(6 == set1->count);
+    assert(0 == strcmp("apple", set1->members[0]));
+    assert(0 == strcmp("blueberry", set1->members[1]));
+    assert(0 == strcmp("cherry", set1->members[2]));
+    assert(0 == strcmp("strawberry", set1->members[3]));
+    assert(0 == strcmp("watermelon", set1->members[4]));
+    assert(0 == strcmp("zucchini", set1->members[5]));
+    
+    result = stringset_apply_delta(set1, delta);
+    assert(0 == result);
+    assert(stringset_is_equal_to(set1, set2));
+    
+    stringset_delta_free(delta);
+    
+    struct stringset *empty = stringset_alloc();
+    assert(empty);
+    delta = stringset_alloc_delta(set1, empty);
+    assert(delta);
+    result = stringset_apply_delta(set1, delta);
+    assert(0 == result);
+    assert(0 == set1->count);
+    
+    stringset_delta_free(delta);
+    stringset_free(empty);
+    stringset_free(set1);
+    stringset_free(set2);
+}
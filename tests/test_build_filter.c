@@ -0,0 +1,60 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "stringset.h"
+
+
+void
+test_build_filter(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    
+    for (int i = 0; i < 1000; i += 2) {
+        char string[16];
+        snprintf(string, sizeof string, "%i", i);
+        int result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    
+    int result = stringset_build_filter(set, 0.01);
+    assert(0 == result);
+    
+    for (int i = 1000; i < 3000; i += 2) {
+        char string[16];
+        snprintf(string, sizeof string, "%i", i);
+        result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    assert(1500 == set->count);
+    
+    for (int i = 0; i < 3000; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%i", i);
+        assert(stringset_contains(set, string) == !(i % 2));
+    }
+    
+    result = stringset_remove(set, "100");
+    assert(0 == result);
+    assert(!stringset_contains(set, "100"));
+    result = stringset_compact(set);
+    assert(0 == result);
+    assert(!stringset_contains(set, "100"));
+    assert(stringset_contains(set, "102"));
+    
+    result = stringset_clear(set);
+    assert(0 == result);
+    assert(!stringset_contains(set, "102"));
+    result = stringset_add(set, "102");
+    assert(0 == result);
+    assert(stringset_contains(set, "102"));
+    
+    result = stringset_build_filter(set, 1.0);
+    assert(-1 == result);
+    
+    result = stringset_drop_filter(set);
+    assert(0 == result);
+    assert(stringset_contains(set, "102"));
+    
+    stringset_free(set);
+}
@@ -0,0 +1,84 @@
+#include <assert.h>
+#include <stdio.h>
+
+#include "stringset.h"
+
+
+static void
+test_build_index_order(enum stringset_order order)
+{
+    struct stringset_options options = { NULL, order, NULL, false, false };
+    struct stringset *set = stringset_alloc_with_options(&options);
+    assert(set);
+    
+    for (int i = 0; i < 1000; i += 2) {
+        char string[32];
+        snprintf(string, sizeof string, "member-%i", i);
+        int result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    int result = stringset_add(set, "");
+    assert(0 == result);
+    result = stringset_add(set, "m");
+    assert(0 == result);
+    
+    result = stringset_build_index(set);
+    assert(0 == result);
+    for (int i = 0; i < 1000; ++i) {
+        char string[32];
+        snprintf(string, sizeof string, "member-%i", i);
+        assert(stringset_contains(set, string) == !(i % 2));
+    }
+    assert(stringset_contains(set, ""));
+    assert(stringset_contains(set, "m"));
+    assert(!stringset_contains(set, "member"));
+    assert(!stringset_contains(set, "member-"));
+    assert(stringset_contains(set, "MEMBER-10")
+           == (stringset_order_case_folded == order));
+    
+    struct stringset *subset = stringset_alloc_with_options(&options);
+    assert(subset);
+    char const *members[] = { "member-10", "member-998", "m" };
+    result = stringset_add_array(subset, members, 3);
+    assert(0 == result);
+    assert(stringset_is_subset_of(subset, set));
+    result = stringset_add(subset, "member-11");
+    assert(0 == result);
+    assert(!stringset_is_subset_of(subset, set));
+    
+    result = stringset_remove(set, "member-10");
+    assert(0 == result);
+    assert(!stringset_contains(set, "member-10"));
+    result = stringset_build_index(set);
+    assert(0 == result);
+    assert(!stringset_contains(set, "member-10"));
+    assert(stringset_contains(set, "member-12"));
+    result = stringset_add(set, "member-11");
+    assert(0 == result);
+    assert(stringset_contains(set, "member-11"));
+    
+    result = stringset_drop_index(set);
+    assert(0 == result);
+    assert(stringset_contains(set, "member-12"));
+    result = stringset_build_index(set);
+    assert(0 == result);
+    
+    stringset_free(subset);
+    stringset_free(set);
+}
+
+
+void
+test_build_index(void)
+{
+    test_build_index_order(stringset_order_lexical);
+    test_build_index_order(stringset_order_length_first);
+    test_build_index_order(stringset_order_case_folded);
+    
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_build_index(set);
+    assert(0 == result);
+    assert(!stringset_contains(set, "a"));
+    stringset_free(set);
+}
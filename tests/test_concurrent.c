@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stringset.h"
+#include "stringset_concurrent.h"
+
+
+#define THREADS_COUNT 4
+#define THREAD_STRINGS_COUNT 2000
+
+
+struct worker {
+    struct stringset_concurrent *concurrent;
+    int id;
+    int added_count;
+};
+
+
+static void *
+work(void *context)
+{
+    struct worker *worker = context;
+    // Each string is added by two of the threads.
+    for (int i = 0; i < THREAD_STRINGS_COUNT; ++i) {
+        char string[32];
+        snprintf(string, sizeof string, "%i-%05i", worker->id / 2, i);
+        int result = stringset_concurrent_add(worker->concurrent, string);
+        assert(-1 != result);
+        assert(stringset_concurrent_contains(worker->concurrent, string));
+        worker->added_count += result;
+    }
+    return NULL;
+}
+
+
+static void
+test_concurrent_members(void)
+{
+    struct stringset_concurrent *concurrent = stringset_concurrent_alloc(0);
+    assert(concurrent);
+    assert(0 == stringset_concurrent_count(concurrent));
+    assert(!stringset_concurrent_contains(concurrent, "0001"));
+    
+    // Starting small makes the table grow several times.
+    for (int i = 1000; i > 0; --i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        int result = stringset_concurrent_add(concurrent, string);
+        assert(1 == result);
+    }
+    int result = stringset_concurrent_add(concurrent, "0042");
+    assert(0 == result);
+    assert(1000 == stringset_concurrent_count(concurrent));
+    assert(stringset_concurrent_contains(concurrent, "0001"));
+    assert(stringset_concurrent_contains(concurrent, "1000"));
+    assert(!stringset_concurrent_contains(concurrent, "1001"));
+    
+    struct stringset *set = stringset_concurrent_alloc_stringset(concurrent,
+                                                                 NULL);
+    assert(set);
+    assert(1000 == set->count);
+    assert(0 == strcmp("0001", set->members[0]));
+    assert(0 == strcmp("1000", set->members[999]));
+    stringset_free(set);
+    
+    struct stringset_options options = {
+        NULL, stringset_order_case_folded, NULL, false, false
+    };
+    result = stringset_concurrent_add(concurrent, "ABC");
+    assert(1 == result);
+    result = stringset_concurrent_add(concurrent, "abc");
+    assert(1 == result);
+    set = stringset_concurrent_alloc_stringset(concurrent, &options);
+    assert(set);
+    assert(1001 == set->count);
+    assert(stringset_contains(set, "Abc"));
+    stringset_free(set);
+    
+    stringset_concurrent_free(concurrent);
+    
+    errno = 0;
+    assert(-1 == stringset_concurrent_add(NULL, "0001"));
+    assert(EINVAL == errno);
+}
+
+
+static void
+test_concurrent_threads(void)
+{
+    struct stringset_concurrent *concurrent = stringset_concurrent_alloc(10);
+    assert(concurrent);
+    
+    struct worker workers[THREADS_COUNT];
+    pthread_t threads[THREADS_COUNT];
+    for (int i = 0; i < THREADS_COUNT; ++i) {
+        workers[i].concurrent = concurrent;
+        workers[i].id = i;
+        workers[i].added_count = 0;
+        int result = pthread_create(&threads[i], NULL, work, &workers[i]);
+        assert(0 == result);
+    }
+    int added_count = 0;
+    for (int i = 0; i < THREADS_COUNT; ++i) {
+        int result = pthread_join(threads[i], NULL);
+        assert(0 == result);
+        added_count += workers[i].added_count;
+    }
+    
+    // Each string was added by exactly one of the two threads adding it.
+    int expected_count = THREADS_COUNT * THREAD_STRINGS_COUNT / 2;
+    assert(expected_count == added_count);
+    assert((size_t)expected_count == stringset_concurrent_count(concurrent));
+    assert(stringset_concurrent_contains(concurrent, "1-01999"));
+    assert(!stringset_concurrent_contains(concurrent, "2-00000"));
+    
+    struct stringset *set = stringset_concurrent_alloc_stringset(concurrent,
+                                                                 NULL);
+    assert(set);
+    assert((size_t)expected_count == set->count);
+    stringset_free(set);
+    
+    stringset_concurrent_free(concurrent);
+}
+
+
+void
+test_concurrent(void)
+{
+    test_concurrent_members();
+    test_concurrent_threads();
+}
@@ -0,0 +1,57 @@
+#include <assert.h>
+#include <errno.h>
+
+#include "stringset.h"
+
+
+void
+test_count_operations(void)
+{
+    char const *members1[] = {
+        "watermelon", "mango", "apple", "banana", "strawberry"
+    };
+    int members1_count = sizeof members1 / sizeof members1[0];
+    struct stringset *set1 = stringset_alloc_from_array(members1, members1_count);
+    assert(set1);
+    
+    char const *members2[] = {
+        "mango", "green", "banana"
+    };
+    int members2_count = sizeof members2 / sizeof members2[0];
+    struct stringset *set2 = stringset_alloc_from_array(members2, members2_count);
+    assert(set2);
+    
+    struct stringset *empty = stringset_alloc();
+    assert(empty);
+    
+    assert(6 == stringset_count_union(set1, set2));
+    assert(2 == stringset_count_intersection(set1, set2));
+    assert(3 == stringset_count_difference(set1, set2));
+    assert(1 == stringset_count_difference(set2, set1));
+    assert(4 == stringset_count_symmetric_difference(set1, set2));
+    assert(2.0 / 6.0 == stringset_jaccard_similarity(set1, set2));
+    
+    assert(5 == stringset_count_union(set1, empty));
+    assert(0 == stringset_count_intersection(empty, set1));
+    assert(0 == stringset_count_symmetric_difference(set1, set1));
+    assert(1.0 == stringset_jaccard_similarity(set1, set1));
+    assert(0.0 == stringset_jaccard_similarity(set1, empty));
+    assert(1.0 == stringset_jaccard_similarity(empty, empty));
+    
+    int result = stringset_set_deferred(empty, true);
+    assert(0 == result);
+    result = stringset_add(empty, "mango");
+    assert(0 == result);
+    result = stringset_add(empty, "apple");
+    assert(0 == result);
+    assert(2 == stringset_count_intersection(set1, empty));
+    
+    errno = 0;
+    assert(0 == stringset_count_union(set1, NULL));
+    assert(EINVAL == errno);
+    assert(-1.0 == stringset_jaccard_similarity(NULL, set1));
+    
+    stringset_free(set1);
+    stringset_free(set2);
+    stringset_free(empty);
+}
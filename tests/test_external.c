@@ -0,0 +1,212 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "stringset.h"
+#include "stringset_external.h"
+
+
+static int
+add_to_stringset(char const *string, void *context)
+{
+    struct stringset *set = context;
+    if (set->count) assert(strcmp(set->members[set->count - 1], string) < 0);
+    return stringset_add(set, string);
+}
+
+
+static int
+stop_at_0042(char const *string, void *context)
+{
+    int *count = context;
+    ++*count;
+    return 0 == strcmp("0042", string) ? 42 : 0;
+}
+
+
+static struct stringset_external *
+alloc_numbers(int first, int last, int step)
+{
+    struct stringset_external *external = stringset_external_alloc(256, NULL);
+    assert(external);
+    
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = last; i >= first; i -= step) {
+            char string[16];
+            snprintf(string, sizeof string, "%04i", i);
+            int result = stringset_external_add(external, string);
+            assert(0 == result);
+        }
+    }
+    return external;
+}
+
+
+static void
+test_external_for_each(void)
+{
+    struct stringset_external *external = alloc_numbers(1, 500, 1);
+    assert(stringset_external_run_count(external) > 1);
+    
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_external_for_each(external, add_to_stringset, set);
+    assert(0 == result);
+    assert(500 == set->count);
+    assert(0 == strcmp("0001", set->members[0]));
+    assert(0 == strcmp("0500", set->members[499]));
+    
+    int count = 0;
+    result = stringset_external_for_each(external, stop_at_0042, &count);
+    assert(42 == result);
+    assert(42 == count);
+    
+    stringset_free(set);
+    stringset_external_free(external);
+}
+
+
+static void
+test_external_many_runs(void)
+{
+    struct stringset_external *external = stringset_external_alloc(0, NULL);
+    assert(external);
+    
+    for (int i = 0; i < 200; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", (i * 37) % 150);
+        int result = stringset_external_add(external, string);
+        assert(0 == result);
+    }
+    
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_external_for_each(external, add_to_stringset, set);
+    assert(0 == result);
+    assert(150 == set->count);
+    assert(stringset_external_run_count(external) < 64);
+    
+    stringset_free(set);
+    stringset_external_free(external);
+}
+
+
+static void
+test_external_more_runs_than_open_files(void)
+{
+    struct rlimit limit;
+    int result = getrlimit(RLIMIT_NOFILE, &limit);
+    assert(0 == result);
+    struct rlimit low_limit = limit;
+    if (low_limit.rlim_cur > 128) low_limit.rlim_cur = 128;
+    result = setrlimit(RLIMIT_NOFILE, &low_limit);
+    assert(0 == result);
+    
+    struct stringset_external *external = stringset_external_alloc(0, NULL);
+    assert(external);
+    for (int i = 0; i < 1000; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", (i * 7) % 1000);
+        result = stringset_external_add(external, string);
+        assert(0 == result);
+        assert(stringset_external_run_count(external) < 64);
+    }
+    
+    // Runs are merged in tiers of 16: 1000 spilled runs leave 3 runs of 256,
+    // 14 runs of 16 and 8 single runs.
+    assert(25 == stringset_external_run_count(external));
+    
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    result = stringset_external_for_each(external, add_to_stringset, set);
+    assert(0 == result);
+    assert(1000 == set->count);
+    
+    stringset_free(set);
+    stringset_external_free(external);
+    result = setrlimit(RLIMIT_NOFILE, &limit);
+    assert(0 == result);
+}
+
+
+static void
+test_external_set_operations(void)
+{
+    struct stringset_external *evens = alloc_numbers(2, 300, 2);
+    struct stringset_external *threes = alloc_numbers(3, 300, 3);
+    
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_external_union(evens, threes, add_to_stringset, set);
+    assert(0 == result);
+    assert(200 == set->count);
+    assert(stringset_contains(set, "0009"));
+    assert(!stringset_contains(set, "0001"));
+    
+    int count = 0;
+    result = stringset_external_union(evens, threes, stop_at_0042, &count);
+    assert(42 == result);
+    assert(28 == count);
+    
+    stringset_clear(set);
+    result = stringset_external_intersection(evens, threes, add_to_stringset, set);
+    assert(0 == result);
+    assert(50 == set->count);
+    assert(stringset_contains(set, "0006"));
+    assert(stringset_contains(set, "0300"));
+    
+    stringset_clear(set);
+    result = stringset_external_difference(evens, threes, add_to_stringset, set);
+    assert(0 == result);
+    assert(100 == set->count);
+    assert(stringset_contains(set, "0002"));
+    assert(!stringset_contains(set, "0006"));
+    
+    stringset_clear(set);
+    result = stringset_external_difference(evens, evens, add_to_stringset, set);
+    assert(0 == result);
+    assert(0 == set->count);
+    
+    stringset_free(set);
+    stringset_external_free(evens);
+    stringset_external_free(threes);
+}
+
+
+static void
+test_external_write(void)
+{
+    struct stringset_external *external = alloc_numbers(1, 100, 1);
+    FILE *file = tmpfile();
+    assert(file);
+    
+    int result = stringset_external_write(external, file);
+    assert(0 == result);
+    
+    rewind(file);
+    char line[16];
+    int count = 0;
+    while (fgets(line, sizeof line, file)) {
+        ++count;
+        char expected[16];
+        snprintf(expected, sizeof expected, "%04i\n", count);
+        assert(0 == strcmp(expected, line));
+    }
+    assert(100 == count);
+    
+    fclose(file);
+    stringset_external_free(external);
+}
+
+
+void
+test_external(void)
+{
+    test_external_for_each();
+    test_external_many_runs();
+    test_external_more_runs_than_open_files();
+    test_external_set_operations();
+    test_external_write();
+}
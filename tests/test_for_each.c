@@ -0,0 +1,208 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+struct visits {
+    int count;
+    char last[16];
+};
+
+
+static int
+visit(char const *member, void *context)
+{
+    struct visits *visits = context;
+    assert(strcmp(visits->last, member) < 0);
+    snprintf(visits->last, sizeof visits->last, "%s", member);
+    ++visits->count;
+    return 0;
+}
+
+
+static int
+stop_at_0042(char const *member, void *context)
+{
+    int *count = context;
+    ++*count;
+    return 0 == strcmp("0042", member) ? 42 : 0;
+}
+
+
+static int
+count_in_parallel(char const *member, void *context)
+{
+    long *sum = context;
+    int number = 0;
+    int result = sscanf(member, "%d", &number);
+    assert(1 == result);
+    __atomic_add_fetch(sum, number, __ATOMIC_RELAXED);
+    return 0;
+}
+
+
+static int
+stop_in_parallel(char const *member, void *context)
+{
+    (void)context;
+    return 0 == strcmp("0777", member) ? 7 : 0;
+}
+
+
+static void *
+sum_repeatedly(void *argument)
+{
+    struct stringset *stringset = argument;
+    for (int i = 0; i < 50; ++i) {
+        long sum = 0;
+        int result = stringset_parallel_for_each(stringset,
+                                                 3,
+                                                 count_in_parallel,
+                                                 &sum);
+        assert(0 == result);
+        assert(1000 * 1001 / 2 == sum);
+    }
+    return NULL;
+}
+
+
+static struct stringset *
+alloc_numbers(int count, bool is_deferred)
+{
+    struct stringset *stringset = stringset_alloc();
+    assert(stringset);
+    int result = stringset_set_deferred(stringset, is_deferred);
+    assert(0 == result);
+    for (int i = count; i > 0; --i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        result = stringset_add(stringset, string);
+        assert(0 == result);
+    }
+    return stringset;
+}
+
+
+static void
+test_cursor(void)
+{
+    struct stringset *stringset = alloc_numbers(100, true);
+    struct stringset_cursor cursor;
+    
+    stringset_cursor_init(&cursor, stringset, false);
+    int count = 0;
+    char const *previous = "";
+    for (char const *member; (member = stringset_cursor_next(&cursor)); ) {
+        assert(strcmp(previous, member) < 0);
+        previous = member;
+        ++count;
+    }
+    assert(100 == count);
+    assert(0 == strcmp("0100", previous));
+    assert(!stringset_cursor_next(&cursor));
+    
+    stringset_cursor_init(&cursor, stringset, true);
+    assert(0 == strcmp("0100", stringset_cursor_next(&cursor)));
+    assert(0 == strcmp("0099", stringset_cursor_next(&cursor)));
+    
+    stringset_free(stringset);
+    
+    // A reverse cursor starts after the pending members too.
+    stringset = alloc_numbers(100, true);
+    stringset_cursor_init(&cursor, stringset, true);
+    count = 0;
+    previous = "~";
+    for (char const *member; (member = stringset_cursor_next(&cursor)); ) {
+        assert(strcmp(previous, member) > 0);
+        previous = member;
+        ++count;
+    }
+    assert(100 == count);
+    assert(0 == strcmp("0001", previous));
+    assert(!stringset_cursor_next(&cursor));
+    stringset_free(stringset);
+    
+    stringset = stringset_alloc();
+    assert(stringset);
+    stringset_cursor_init(&cursor, stringset, true);
+    assert(!stringset_cursor_next(&cursor));
+    stringset_free(stringset);
+}
+
+
+static void
+test_for_each_member(void)
+{
+    struct stringset *stringset = alloc_numbers(100, true);
+    
+    struct visits visits = { 0, "" };
+    int result = stringset_for_each(stringset, visit, &visits);
+    assert(0 == result);
+    assert(100 == visits.count);
+    
+    int count = 0;
+    result = stringset_for_each(stringset, stop_at_0042, &count);
+    assert(42 == result);
+    assert(42 == count);
+    
+    errno = 0;
+    result = stringset_for_each(stringset, NULL, NULL);
+    assert(-1 == result);
+    assert(EINVAL == errno);
+    
+    stringset_free(stringset);
+}
+
+
+static void
+test_parallel_for_each(void)
+{
+    struct stringset *stringset = alloc_numbers(1000, true);
+    
+    long sum = 0;
+    int result = stringset_parallel_for_each(stringset,
+                                             4,
+                                             count_in_parallel,
+                                             &sum);
+    assert(0 == result);
+    assert(1000 * 1001 / 2 == sum);
+    
+    sum = 0;
+    result = stringset_parallel_for_each(stringset, 1, count_in_parallel, &sum);
+    assert(0 == result);
+    assert(1000 * 1001 / 2 == sum);
+    
+    result = stringset_parallel_for_each(stringset, 3, stop_in_parallel, NULL);
+    assert(7 == result);
+    
+    // Worker threads are reused across calls, including concurrent ones.
+    sum_repeatedly(stringset);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; ++i) {
+        result = pthread_create(&threads[i], NULL, sum_repeatedly, stringset);
+        assert(0 == result);
+    }
+    for (int i = 0; i < 4; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    errno = 0;
+    result = stringset_parallel_for_each(stringset, 0, stop_in_parallel, NULL);
+    assert(-1 == result);
+    assert(EINVAL == errno);
+    
+    stringset_free(stringset);
+}
+
+
+void
+test_for_each(void)
+{
+    test_cursor();
+    test_for_each_member();
+    test_parallel_for_each();
+}
@@ -0,0 +1,233 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+#include "stringset_persistent.h"
+
+
+static int
+check_order(char const *string, void *context)
+{
+    char const **last = context;
+    if (*last) assert(strcmp(*last, string) < 0);
+    *last = string;
+    return 0;
+}
+
+
+static int
+stop_at_fig(char const *string, void *context)
+{
+    int *count = context;
+    ++*count;
+    return 0 == strcmp("fig", string) ? 7 : 0;
+}
+
+
+static void
+assert_matches(struct stringset_persistent const *persistent,
+               struct stringset *set)
+{
+    assert(set->count == stringset_persistent_count(persistent));
+    for (size_t i = 0; i < set->count; ++i) {
+        assert(stringset_persistent_contains(persistent, set->members[i]));
+    }
+    char const *last = NULL;
+    int result = stringset_persistent_for_each(persistent, check_order, &last);
+    assert(0 == result);
+}
+
+
+static void
+test_persistent_versions(void)
+{
+    enum { version_count = 300 };
+    struct stringset_persistent *versions[version_count + 1];
+    struct stringset *sets[version_count + 1];
+    versions[0] = stringset_persistent_alloc();
+    sets[0] = stringset_alloc();
+    assert(versions[0] && sets[0]);
+    
+    srand(37);
+    for (int i = 1; i <= version_count; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%03i", rand() % 200);
+        sets[i] = stringset_alloc_from_stringset(sets[i - 1]);
+        assert(sets[i]);
+        int result;
+        if (rand() % 3) {
+            versions[i] = stringset_persistent_add(versions[i - 1], string);
+            result = stringset_add(sets[i], string);
+        } else {
+            versions[i] = stringset_persistent_remove(versions[i - 1], string);
+            result = stringset_remove(sets[i], string);
+        }
+        assert(versions[i]);
+        assert(0 == result);
+    }
+    
+    for (int i = 0; i <= version_count; ++i) {
+        assert_matches(versions[i], sets[i]);
+        struct stringset *set;
+        set = stringset_persistent_alloc_stringset(versions[i]);
+        assert(set);
+        assert(stringset_is_equal_to(set, sets[i]));
+        stringset_free(set);
+    }
+    
+    for (int i = 0; i <= version_count; i += 2) {
+        stringset_persistent_free(versions[i]);
+        stringset_free(sets[i]);
+    }
+    for (int i = 1; i <= version_count; i += 2) {
+        assert_matches(versions[i], sets[i]);
+        stringset_persistent_free(versions[i]);
+        stringset_free(sets[i]);
+    }
+}
+
+
+static void
+test_persistent_set_operations(void)
+{
+    struct stringset *evens = stringset_alloc();
+    struct stringset *threes = stringset_alloc();
+    assert(evens && threes);
+    for (int i = 0; i < 600; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        int result = 0;
+        if (0 == i % 2) result |= stringset_add(evens, string);
+        if (0 == i % 3) result |= stringset_add(threes, string);
+        assert(0 == result);
+    }
+    
+    struct stringset_persistent *first;
+    first = stringset_persistent_alloc_from_stringset(evens);
+    struct stringset_persistent *second;
+    second = stringset_persistent_alloc_from_stringset(threes);
+    assert(first && second);
+    assert_matches(first, evens);
+    
+    struct stringset_persistent *unions;
+    unions = stringset_persistent_alloc_union(first, second);
+    struct stringset *expected = stringset_alloc_union(evens, threes);
+    assert(unions && expected);
+    assert_matches(unions, expected);
+    stringset_free(expected);
+    
+    struct stringset_persistent *intersection;
+    intersection = stringset_persistent_alloc_intersection(first, second);
+    expected = stringset_alloc_intersection(evens, threes);
+    assert(intersection && expected);
+    assert_matches(intersection, expected);
+    assert(stringset_persistent_is_subset_of(intersection, first));
+    assert(!stringset_persistent_is_subset_of(first, intersection));
+    assert(stringset_persistent_is_superset_of(first, intersection));
+    assert(stringset_persistent_is_proper_subset_of(intersection, first));
+    assert(stringset_persistent_is_proper_superset_of(first, intersection));
+    assert(!stringset_persistent_is_proper_subset_of(first, first));
+    assert(!stringset_persistent_is_proper_superset_of(first, first));
+    stringset_free(expected);
+    
+    struct stringset_persistent *difference;
+    difference = stringset_persistent_alloc_difference(first, second);
+    expected = stringset_alloc_difference(evens, threes);
+    assert(difference && expected);
+    assert_matches(difference, expected);
+    assert(stringset_persistent_is_disjoint_from(difference, second));
+    assert(!stringset_persistent_is_disjoint_from(first, second));
+    stringset_free(expected);
+    
+    struct stringset_persistent *symmetric_difference;
+    symmetric_difference
+        = stringset_persistent_alloc_symmetric_difference(first, second);
+    expected = stringset_alloc_symmetric_difference(evens, threes);
+    assert(symmetric_difference && expected);
+    assert_matches(symmetric_difference, expected);
+    stringset_free(expected);
+    
+    struct stringset_persistent *same;
+    same = stringset_persistent_alloc_intersection(first, first);
+    assert(same);
+    assert(stringset_persistent_is_equal_to(same, first));
+    struct stringset_persistent *none;
+    none = stringset_persistent_alloc_difference(first, first);
+    assert(none);
+    assert(0 == stringset_persistent_count(none));
+    
+    stringset_persistent_free(none);
+    stringset_persistent_free(same);
+    stringset_persistent_free(symmetric_difference);
+    stringset_persistent_free(difference);
+    stringset_persistent_free(intersection);
+    stringset_persistent_free(unions);
+    stringset_persistent_free(second);
+    stringset_persistent_free(first);
+    stringset_free(threes);
+    stringset_free(evens);
+}
+
+
+static void
+test_persistent_alloc_from_array(void)
+{
+    char const *array[] = { "pear", "apple", "fig", "apple", "banana" };
+    struct stringset_persistent *persistent;
+    persistent = stringset_persistent_alloc_from_array(array, 5);
+    assert(persistent);
+    assert(4 == stringset_persistent_count(persistent));
+    
+    struct stringset *set = stringset_alloc_from_array(array, 5);
+    assert(set);
+    assert_matches(persistent, set);
+    stringset_free(set);
+    
+    int count = 0;
+    int result = stringset_persistent_for_each(persistent, stop_at_fig, &count);
+    assert(7 == result);
+    assert(3 == count);
+    stringset_persistent_free(persistent);
+    
+    persistent = stringset_persistent_alloc_from_array(array, 0);
+    assert(persistent);
+    assert(0 == stringset_persistent_count(persistent));
+    stringset_persistent_free(persistent);
+}
+
+
+static void
+test_persistent_alloc_from_stringset_order(void)
+{
+    struct stringset_options options = {
+        .order = stringset_order_length_first,
+    };
+    struct stringset *set = stringset_alloc_with_options(&options);
+    assert(set);
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    char const *array[] = { "pear", "apple", "fig", "kiwi", "banana" };
+    result = stringset_add_array(set, array, 5);
+    assert(0 == result);
+    
+    struct stringset const *source = set;
+    struct stringset_persistent *persistent;
+    persistent = stringset_persistent_alloc_from_stringset(source);
+    assert(persistent);
+    assert_matches(persistent, set);
+    
+    stringset_persistent_free(persistent);
+    stringset_free(set);
+}
+
+
+void
+test_persistent(void)
+{
+    test_persistent_versions();
+    test_persistent_set_operations();
+    test_persistent_alloc_from_array();
+    test_persistent_alloc_from_stringset_order();
+}
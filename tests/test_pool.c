@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+static struct stringset *
+alloc_with_pool(struct stringset_pool *pool)
+{
+    struct stringset_options options = {
+        NULL, stringset_order_lexical, pool, false, false
+    };
+    struct stringset *set = stringset_alloc_with_options(&options);
+    assert(set);
+    assert(pool == set->pool);
+    return set;
+}
+
+
+static void
+test_pool_shares_members(void)
+{
+    struct stringset_pool *pool = stringset_pool_alloc();
+    assert(pool);
+    assert(0 == stringset_pool_count(pool));
+    
+    struct stringset *first = alloc_with_pool(pool);
+    struct stringset *second = alloc_with_pool(pool);
+    char const *first_members[] = { "apple", "banana", "cherry" };
+    char const *second_members[] = { "banana", "cherry", "date" };
+    int result = stringset_add_array(first, first_members, 3);
+    assert(0 == result);
+    result = stringset_add_array(second, second_members, 3);
+    assert(0 == result);
+    assert(4 == stringset_pool_count(pool));
+    assert(first->members[1] == second->members[0]);
+    assert(first->members[2] == second->members[1]);
+    
+    struct stringset *copy = stringset_alloc_from_stringset(first);
+    assert(copy);
+    assert(pool == copy->pool);
+    for (size_t i = 0; i < first->count; ++i) {
+        assert(first->members[i] == copy->members[i]);
+    }
+    assert(stringset_is_equal_to(first, copy));
+    assert(!stringset_is_equal_to(first, second));
+    
+    struct stringset *intersection = stringset_alloc_intersection(first,
+                                                                  second);
+    assert(intersection);
+    assert(2 == intersection->count);
+    assert(first->members[1] == intersection->members[0]);
+    assert(4 == stringset_pool_count(pool));
+    
+    result = stringset_remove(first, "apple");
+    assert(0 == result);
+    assert(4 == stringset_pool_count(pool));
+    result = stringset_remove(copy, "apple");
+    assert(0 == result);
+    assert(3 == stringset_pool_count(pool));
+    
+    stringset_free(intersection);
+    stringset_free(copy);
+    stringset_free(second);
+    assert(2 == stringset_pool_count(pool));
+    stringset_free(first);
+    assert(0 == stringset_pool_count(pool));
+    
+    stringset_pool_free(pool);
+}
+
+
+static void
+test_pool_many_members(void)
+{
+    struct stringset_pool *pool = stringset_pool_alloc();
+    assert(pool);
+    struct stringset *evens = alloc_with_pool(pool);
+    struct stringset *threes = alloc_with_pool(pool);
+    struct stringset *unpooled = stringset_alloc();
+    assert(unpooled);
+    
+    for (int i = 0; i < 1000; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        int result = 0;
+        if (0 == i % 2) result |= stringset_add(evens, string);
+        if (0 == i % 3) result |= stringset_add(threes, string);
+        result |= stringset_add(unpooled, string);
+        assert(0 == result);
+    }
+    assert(667 == stringset_pool_count(pool));
+    
+    struct stringset *all = alloc_with_pool(pool);
+    int result = stringset_add_stringset(all, unpooled);
+    assert(0 == result);
+    assert(1000 == stringset_pool_count(pool));
+    assert(stringset_is_equal_to(all, unpooled));
+    
+    struct stringset *difference = stringset_alloc_difference(all, evens);
+    assert(difference);
+    result = stringset_remove_stringset(difference, threes);
+    assert(0 == result);
+    assert(333 == difference->count);
+    
+    struct stringset_delta *delta = stringset_alloc_delta(evens, threes);
+    assert(delta);
+    result = stringset_apply_delta(evens, delta);
+    assert(0 == result);
+    assert(stringset_is_equal_to(evens, threes));
+    stringset_delta_free(delta);
+    
+    stringset_free(all);
+    stringset_free(difference);
+    stringset_free(evens);
+    stringset_free(threes);
+    assert(0 == stringset_pool_count(pool));
+    stringset_free(unpooled);
+    stringset_pool_free(pool);
+}
+
+
+void
+test_pool(void)
+{
+    test_pool_shares_members();
+    test_pool_many_members();
+}
@@ -0,0 +1,186 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stringset.h"
+#include "stringset_queue.h"
+
+
+#define PRODUCERS_COUNT 4
+#define PRODUCER_STRINGS_COUNT 1000
+
+
+struct producer {
+    struct stringset_queue *queue;
+    int id;
+};
+
+
+struct consumer {
+    struct stringset_queue *queue;
+    bool is_stopped;
+};
+
+
+static void *
+produce(void *context)
+{
+    struct producer *producer = context;
+    for (int i = 0; i < PRODUCER_STRINGS_COUNT; ++i) {
+        char string[32];
+        snprintf(string, sizeof string, "%i-%04i", producer->id, i);
+        int result = stringset_queue_add(producer->queue, string);
+        assert(0 == result);
+        if (i % 10 == 9) {
+            snprintf(string, sizeof string, "%i-%04i", producer->id, i - 1);
+            result = stringset_queue_remove(producer->queue, string);
+            assert(0 == result);
+        }
+    }
+    int result = stringset_queue_flush(producer->queue);
+    assert(0 == result);
+    return NULL;
+}
+
+
+static void *
+consume(void *context)
+{
+    struct consumer *consumer = context;
+    while (!__atomic_load_n(&consumer->is_stopped, __ATOMIC_ACQUIRE)) {
+        int result = stringset_queue_apply(consumer->queue, 256);
+        assert(result >= 0);
+    }
+    return NULL;
+}
+
+
+static void
+test_queue_apply(void)
+{
+    char const *members[] = { "date", "fig" };
+    struct stringset *set = stringset_alloc_from_array(members, 2);
+    assert(set);
+    struct stringset_queue *queue = stringset_queue_alloc(set);
+    assert(queue);
+    
+    int result = stringset_queue_add(queue, "apple");
+    assert(0 == result);
+    result = stringset_queue_add(queue, "banana");
+    assert(0 == result);
+    result = stringset_queue_remove(queue, "apple");
+    assert(0 == result);
+    result = stringset_queue_add(queue, "cherry");
+    assert(0 == result);
+    result = stringset_queue_add(queue, "cherry");
+    assert(0 == result);
+    result = stringset_queue_remove(queue, "date");
+    assert(0 == result);
+    result = stringset_queue_remove(queue, "grape");
+    assert(0 == result);
+    assert(2 == set->count);
+    
+    result = stringset_queue_apply(queue, 4);
+    assert(4 == result);
+    assert(4 == set->count);
+    assert(stringset_contains(set, "banana"));
+    assert(stringset_contains(set, "cherry"));
+    assert(!stringset_contains(set, "apple"));
+    
+    result = stringset_queue_apply(queue, 100);
+    assert(3 == result);
+    assert(3 == set->count);
+    assert(!stringset_contains(set, "date"));
+    assert(stringset_contains(set, "fig"));
+    
+    result = stringset_queue_apply(queue, 100);
+    assert(0 == result);
+    result = stringset_queue_apply(queue, 0);
+    assert(-1 == result);
+    
+    stringset_queue_free(queue);
+    stringset_free(set);
+}
+
+
+static void
+test_queue_flush(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    struct stringset_queue *queue = stringset_queue_alloc(set);
+    assert(queue);
+    
+    int result = stringset_queue_flush(queue);
+    assert(0 == result);
+    
+    result = stringset_queue_add(queue, "banana");
+    assert(0 == result);
+    result = stringset_queue_add(queue, "apple");
+    assert(0 == result);
+    result = stringset_queue_flush(queue);
+    assert(0 == result);
+    assert(2 == set->count);
+    assert(0 == strcmp("apple", set->members[0]));
+    
+    result = stringset_queue_add(queue, "cherry");
+    assert(0 == result);
+    stringset_queue_free(queue);
+    assert(2 == set->count);
+    
+    stringset_free(set);
+}
+
+
+static void
+test_queue_producers(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    struct stringset_queue *queue = stringset_queue_alloc(set);
+    assert(queue);
+    
+    struct consumer consumer = { queue, false };
+    pthread_t consumer_thread;
+    int result = pthread_create(&consumer_thread, NULL, consume, &consumer);
+    assert(0 == result);
+    
+    struct producer producers[PRODUCERS_COUNT];
+    pthread_t producer_threads[PRODUCERS_COUNT];
+    for (int i = 0; i < PRODUCERS_COUNT; ++i) {
+        producers[i].queue = queue;
+        producers[i].id = i;
+        result = pthread_create(&producer_threads[i],
+                                NULL,
+                                produce,
+                                &producers[i]);
+        assert(0 == result);
+    }
+    for (int i = 0; i < PRODUCERS_COUNT; ++i) {
+        result = pthread_join(producer_threads[i], NULL);
+        assert(0 == result);
+    }
+    
+    __atomic_store_n(&consumer.is_stopped, true, __ATOMIC_RELEASE);
+    result = pthread_join(consumer_thread, NULL);
+    assert(0 == result);
+    
+    int expected_count = PRODUCERS_COUNT * PRODUCER_STRINGS_COUNT * 9 / 10;
+    assert((size_t)expected_count == set->count);
+    assert(stringset_contains(set, "0-0000"));
+    assert(!stringset_contains(set, "0-0008"));
+    assert(stringset_contains(set, "3-0999"));
+    
+    stringset_queue_free(queue);
+    stringset_free(set);
+}
+
+
+void
+test_queue(void)
+{
+    test_queue_apply();
+    test_queue_flush();
+    test_queue_producers();
+}
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <errno.h>
 
 #include "stringset.h"
 
@@ -24,6 +25,24 @@ test_retain_array(void)
     assert(stringset_contains(set, "banana"));
     assert(stringset_contains(set, "mango"));
     
+    char const *duplicates[] = {
+        "mango", "zucchini", "mango"
+    };
+    int duplicates_count = sizeof duplicates / sizeof duplicates[0];
+    result = stringset_retain_array(set, duplicates, duplicates_count);
+    assert(0 == result);
+    assert(1 == set->count);
+    assert(stringset_contains(set, "mango"));
+    
+    char const *null_array[] = {
+        "mango", NULL
+    };
+    errno = 0;
+    result = stringset_retain_array(set, null_array, 2);
+    assert(-1 == result);
+    assert(EINVAL == errno);
+    assert(1 == set->count);
+    
     char const *empty_array[0];
     int empty_array_count = 0;
     result = stringset_retain_array(set, empty_array, empty_array_count);
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+static void
+test_serialize_round_trip(void)
+{
+    enum stringset_order const orders[] = {
+        stringset_order_lexical,
+        stringset_order_length_first,
+        stringset_order_case_folded
+    };
+    for (int i = 0; i < 3; ++i) {
+        struct stringset_options options = {
+            NULL, orders[i], NULL, false, false
+        };
+        struct stringset *stringset = stringset_alloc_with_options(&options);
+        assert(stringset);
+        int result = stringset_set_deferred(stringset, true);
+        assert(0 == result);
+        for (int j = 0; j < 1000; ++j) {
+            char string[32];
+            snprintf(string, sizeof string, "%s-%i", j % 2 ? "Key" : "k", j);
+            result = stringset_add(stringset, string);
+            assert(0 == result);
+        }
+        
+        size_t size = 0;
+        void *bytes = stringset_serialize(stringset, &size);
+        assert(bytes);
+        struct stringset *copy = stringset_alloc_from_bytes(bytes, size);
+        assert(copy);
+        assert(stringset_is_equal_to(stringset, copy));
+        assert(orders[i] == copy->order);
+        assert(1000 == copy->count);
+        assert(stringset_contains(copy, "Key-999"));
+        
+        stringset_free(copy);
+        free(bytes);
+        stringset_free(stringset);
+    }
+}
+
+
+static void
+test_serialize_empty(void)
+{
+    struct stringset *stringset = stringset_alloc();
+    assert(stringset);
+    size_t size = 0;
+    void *bytes = stringset_serialize(stringset, &size);
+    assert(bytes);
+    
+    struct stringset *copy = stringset_alloc_from_bytes(bytes, size);
+    assert(copy);
+    assert(0 == copy->count);
+    
+    stringset_free(copy);
+    free(bytes);
+    stringset_free(stringset);
+}
+
+
+static void
+test_serialize_invalid_bytes(void)
+{
+    char const *strings[] = { "blue", "green", "red" };
+    struct stringset *stringset = stringset_alloc_from_array(strings, 3);
+    assert(stringset);
+    size_t size = 0;
+    unsigned char *bytes = stringset_serialize(stringset, &size);
+    assert(bytes);
+    
+    // Every corrupted byte is caught by the checksum or the header.
+    for (size_t i = 0; i < size; ++i) {
+        bytes[i] ^= 0x20;
+        errno = 0;
+        assert(!stringset_alloc_from_bytes(bytes, size));
+        assert(EINVAL == errno);
+        bytes[i] ^= 0x20;
+    }
+    
+    errno = 0;
+    assert(!stringset_alloc_from_bytes(bytes, size - 1));
+    assert(EINVAL == errno);
+    errno = 0;
+    assert(!stringset_alloc_from_bytes(bytes, 3));
+    assert(EINVAL == errno);
+    errno = 0;
+    assert(!stringset_serialize(NULL, &size));
+    assert(EINVAL == errno);
+    
+    free(bytes);
+    stringset_free(stringset);
+}
+
+
+void
+test_serialize(void)
+{
+    test_serialize_round_trip();
+    test_serialize_empty();
+    test_serialize_invalid_bytes();
+}
@@ -0,0 +1,64 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+void
+test_set_deferred(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    
+    for (int i = 1000; i > 0; --i) {
+        char *string;
+        int chars_formatted = asprintf(&string, "%i", i);
+        assert(chars_formatted > 0);
+        result = stringset_add(set, string);
+        assert(0 == result);
+        result = stringset_add(set, string);
+        assert(0 == result);
+        assert(stringset_contains(set, string));
+        free(string);
+    }
+    
+    assert(1000 == set->count);
+    assert(set->pending_count > 0);
+    assert(stringset_contains(set, "1"));
+    assert(stringset_contains(set, "500"));
+    assert(stringset_contains(set, "1000"));
+    assert(!stringset_contains(set, "0"));
+    assert(!stringset_contains(set, "1001"));
+    
+    result = stringset_flush(set);
+    assert(0 == result);
+    assert(0 == set->pending_count);
+    for (size_t i = 1; i < set->count; ++i) {
+        assert(strcmp(set->members[i - 1], set->members[i]) < 0);
+    }
+    
+    result = stringset_add(set, "apple");
+    assert(0 == result);
+    assert(1 == set->pending_count);
+    
+    result = stringset_remove(set, "500");
+    assert(0 == result);
+    assert(0 == set->pending_count);
+    assert(1000 == set->count);
+    assert(!stringset_contains(set, "500"));
+    assert(0 == strcmp("apple", set->members[set->count - 1]));
+    
+    result = stringset_add(set, "banana");
+    assert(0 == result);
+    result = stringset_set_deferred(set, false);
+    assert(0 == result);
+    assert(0 == set->pending_count);
+    assert(0 == strcmp("banana", set->members[set->count - 1]));
+    
+    stringset_free(set);
+}
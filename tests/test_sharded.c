@@ -0,0 +1,193 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stringset.h"
+#include "stringset_sharded.h"
+
+
+#define THREADS_COUNT 4
+#define THREAD_STRINGS_COUNT 500
+
+
+struct worker {
+    struct stringset_sharded *sharded;
+    int id;
+};
+
+
+static struct stringset_sharded *
+alloc_numbers(int first, int last, int step)
+{
+    struct stringset_sharded *sharded = stringset_sharded_alloc(8, NULL);
+    assert(sharded);
+    for (int i = first; i <= last; i += step) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        int result = stringset_sharded_add(sharded, string);
+        assert(0 == result);
+    }
+    return sharded;
+}
+
+
+static void *
+work(void *context)
+{
+    struct worker *worker = context;
+    for (int i = 0; i < THREAD_STRINGS_COUNT; ++i) {
+        char string[32];
+        snprintf(string, sizeof string, "%i-%04i", worker->id, i);
+        int result = stringset_sharded_add(worker->sharded, string);
+        assert(0 == result);
+        assert(stringset_sharded_contains(worker->sharded, string));
+        if (i % 2) {
+            result = stringset_sharded_remove(worker->sharded, string);
+            assert(0 == result);
+            assert(!stringset_sharded_contains(worker->sharded, string));
+        }
+    }
+    return NULL;
+}
+
+
+static void
+test_sharded_members(void)
+{
+    struct stringset_sharded *sharded = alloc_numbers(1, 100, 1);
+    assert(8 == stringset_sharded_shard_count(sharded));
+    assert(100 == stringset_sharded_count(sharded));
+    assert(stringset_sharded_contains(sharded, "0042"));
+    assert(!stringset_sharded_contains(sharded, "0101"));
+    
+    int result = stringset_sharded_add(sharded, "0042");
+    assert(0 == result);
+    assert(100 == stringset_sharded_count(sharded));
+    result = stringset_sharded_remove(sharded, "0042");
+    assert(0 == result);
+    assert(99 == stringset_sharded_count(sharded));
+    assert(!stringset_sharded_contains(sharded, "0042"));
+    
+    struct stringset *set = stringset_sharded_alloc_stringset(sharded);
+    assert(set);
+    assert(99 == set->count);
+    assert(0 == strcmp("0001", set->members[0]));
+    assert(0 == strcmp("0041", set->members[40]));
+    assert(0 == strcmp("0043", set->members[41]));
+    stringset_free(set);
+    
+    stringset_sharded_free(sharded);
+}
+
+
+static void
+test_sharded_case_folded(void)
+{
+    struct stringset_options options = {
+        NULL, stringset_order_case_folded, NULL, false, false
+    };
+    struct stringset_sharded *sharded = stringset_sharded_alloc(16, &options);
+    assert(sharded);
+    
+    int result = stringset_sharded_add(sharded, "Apple");
+    assert(0 == result);
+    result = stringset_sharded_add(sharded, "APPLE");
+    assert(0 == result);
+    assert(1 == stringset_sharded_count(sharded));
+    assert(stringset_sharded_contains(sharded, "apple"));
+    stringset_sharded_free(sharded);
+    
+    struct stringset_pool *pool = stringset_pool_alloc();
+    assert(pool);
+    options.pool = pool;
+    errno = 0;
+    assert(!stringset_sharded_alloc(16, &options));
+    assert(EINVAL == errno);
+    stringset_pool_free(pool);
+    
+    assert(!stringset_sharded_alloc(0, NULL));
+}
+
+
+static void
+test_sharded_set_operations(void)
+{
+    struct stringset_sharded *evens = alloc_numbers(2, 300, 2);
+    struct stringset_sharded *threes = alloc_numbers(3, 300, 3);
+    
+    struct stringset_sharded *result = stringset_sharded_alloc_union(evens,
+                                                                     threes);
+    assert(result);
+    assert(200 == stringset_sharded_count(result));
+    assert(stringset_sharded_contains(result, "0009"));
+    assert(!stringset_sharded_contains(result, "0001"));
+    stringset_sharded_free(result);
+    
+    result = stringset_sharded_alloc_intersection(evens, threes);
+    assert(result);
+    assert(50 == stringset_sharded_count(result));
+    assert(stringset_sharded_contains(result, "0006"));
+    stringset_sharded_free(result);
+    
+    result = stringset_sharded_alloc_difference(evens, threes);
+    assert(result);
+    assert(100 == stringset_sharded_count(result));
+    assert(stringset_sharded_contains(result, "0002"));
+    assert(!stringset_sharded_contains(result, "0006"));
+    stringset_sharded_free(result);
+    
+    result = stringset_sharded_alloc_difference(evens, evens);
+    assert(result);
+    assert(0 == stringset_sharded_count(result));
+    stringset_sharded_free(result);
+    
+    struct stringset_sharded *other = stringset_sharded_alloc(4, NULL);
+    assert(other);
+    errno = 0;
+    assert(!stringset_sharded_alloc_union(evens, other));
+    assert(EINVAL == errno);
+    stringset_sharded_free(other);
+    
+    stringset_sharded_free(evens);
+    stringset_sharded_free(threes);
+}
+
+
+static void
+test_sharded_threads(void)
+{
+    struct stringset_sharded *sharded = stringset_sharded_alloc(4, NULL);
+    assert(sharded);
+    
+    struct worker workers[THREADS_COUNT];
+    pthread_t threads[THREADS_COUNT];
+    for (int i = 0; i < THREADS_COUNT; ++i) {
+        workers[i].sharded = sharded;
+        workers[i].id = i;
+        int result = pthread_create(&threads[i], NULL, work, &workers[i]);
+        assert(0 == result);
+    }
+    for (int i = 0; i < THREADS_COUNT; ++i) {
+        int result = pthread_join(threads[i], NULL);
+        assert(0 == result);
+    }
+    
+    int expected_count = THREADS_COUNT * THREAD_STRINGS_COUNT / 2;
+    assert((size_t)expected_count == stringset_sharded_count(sharded));
+    assert(stringset_sharded_contains(sharded, "3-0000"));
+    assert(!stringset_sharded_contains(sharded, "3-0001"));
+    
+    stringset_sharded_free(sharded);
+}
+
+
+void
+test_sharded(void)
+{
+    test_sharded_members();
+    test_sharded_case_folded();
+    test_sharded_set_operations();
+    test_sharded_threads();
+}
@@ -0,0 +1,77 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+static void
+test_short_and_long_members(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    
+    // 15 characters is the longest short string.
+    char const *members[] = {
+        "", "a", "fifteen-chars-x", "sixteen-chars-xx", "a much longer member"
+    };
+    int members_count = sizeof members / sizeof members[0];
+    int result = stringset_add_array(set, members, members_count);
+    assert(0 == result);
+    assert(5 == set->count);
+    for (int i = 0; i < members_count; ++i) {
+        assert(stringset_contains(set, members[i]));
+    }
+    
+    result = stringset_remove(set, "fifteen-chars-x");
+    assert(0 == result);
+    result = stringset_remove(set, "sixteen-chars-xx");
+    assert(0 == result);
+    assert(!stringset_contains(set, "fifteen-chars-x"));
+    
+    // Freed slots are reused.
+    result = stringset_add(set, "b");
+    assert(0 == result);
+    assert(stringset_contains(set, "b"));
+    assert(4 == set->count);
+    
+    stringset_free(set);
+}
+
+
+static void
+test_short_strings_shared_by_clones(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    for (int i = 0; i < 1000; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%04i", i);
+        int result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    
+    // The clone outlives the string set whose slabs hold its strings.
+    struct stringset *clone = stringset_alloc_from_stringset(set);
+    assert(clone);
+    int result = stringset_remove(set, "0042");
+    assert(0 == result);
+    stringset_free(set);
+    
+    assert(1000 == clone->count);
+    assert(stringset_contains(clone, "0042"));
+    assert(0 == strcmp("0999", clone->members[999]));
+    result = stringset_add(clone, "1000");
+    assert(0 == result);
+    assert(stringset_contains(clone, "1000"));
+    
+    stringset_free(clone);
+}
+
+
+void
+test_short_strings(void)
+{
+    test_short_and_long_members();
+    test_short_strings_shared_by_clones();
+}
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "stringset.h"
+
+
+static struct stringset *
+alloc_numbers(int first, int last)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    
+    for (int i = first; i <= last; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%i", i);
+        result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    
+    result = stringset_set_deferred(set, false);
+    assert(0 == result);
+    return set;
+}
+
+
+// Check that an estimate is within `tolerance' of `expected', relative to
+// `scale'.
+static void
+assert_near(double expected, double estimate, double scale, double tolerance)
+{
+    assert(fabs(estimate - expected) <= tolerance * scale);
+}
+
+
+static void
+test_sketch_estimate_attached(void)
+{
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_set_deferred(set, true);
+    assert(0 == result);
+    result = stringset_add(set, "before");
+    assert(0 == result);
+    
+    struct stringset_sketch *sketch = stringset_sketch_alloc(12);
+    assert(sketch);
+    result = stringset_attach_sketch(set, sketch);
+    assert(0 == result);
+    
+    for (int i = 0; i < 9999; ++i) {
+        char string[16];
+        snprintf(string, sizeof string, "%i", i);
+        result = stringset_add(set, string);
+        assert(0 == result);
+    }
+    result = stringset_add(set, "before");
+    assert(0 == result);
+    assert_near(10000, stringset_sketch_estimate(sketch), 10000, 0.05);
+    
+    result = stringset_attach_sketch(set, NULL);
+    assert(0 == result);
+    result = stringset_add(set, "after");
+    assert(0 == result);
+    assert(!set->sketch);
+    
+    stringset_sketch_free(sketch);
+    stringset_free(set);
+}
+
+
+static void
+test_sketch_estimate_errors(void)
+{
+    errno = 0;
+    assert(!stringset_sketch_alloc(3));
+    assert(EINVAL == errno);
+    assert(!stringset_sketch_alloc(19));
+    
+    struct stringset_sketch *small = stringset_sketch_alloc(4);
+    struct stringset_sketch *large = stringset_sketch_alloc(10);
+    assert(small && large);
+    assert(0.0 == stringset_sketch_estimate(small));
+    
+    errno = 0;
+    assert(-1 == stringset_sketch_merge(small, large));
+    assert(EINVAL == errno);
+    
+    struct stringset_sketch const *sketches[] = { small, large };
+    assert(stringset_sketch_estimate_union(sketches, 2) < 0.0);
+    assert(stringset_sketch_estimate_union(sketches, 0) < 0.0);
+    assert(stringset_sketch_estimate_intersection(sketches, 2) < 0.0);
+    
+    stringset_sketch_free(small);
+    stringset_sketch_free(large);
+}
+
+
+static void
+test_sketch_estimate_union_and_intersection(void)
+{
+    struct stringset *first = alloc_numbers(0, 29999);
+    struct stringset *second = alloc_numbers(20000, 49999);
+    struct stringset *third = alloc_numbers(25000, 34999);
+    
+    struct stringset_sketch *sketches[3] = {
+        stringset_sketch_alloc_from_stringset(first, 14),
+        stringset_sketch_alloc_from_stringset(second, 14),
+        stringset_sketch_alloc_from_stringset(third, 14),
+    };
+    assert(sketches[0] && sketches[1] && sketches[2]);
+    struct stringset_sketch const *const *const_sketches;
+    const_sketches = (struct stringset_sketch const *const *)sketches;
+    
+    assert_near(30000, stringset_sketch_estimate(sketches[0]), 30000, 0.03);
+    
+    double estimate = stringset_sketch_estimate_union(const_sketches, 2);
+    assert_near(50000, estimate, 50000, 0.03);
+    estimate = stringset_sketch_estimate_union(const_sketches, 3);
+    assert_near(50000, estimate, 50000, 0.03);
+    
+    estimate = stringset_sketch_estimate_intersection(const_sketches, 2);
+    assert_near(10000, estimate, 50000, 0.06);
+    estimate = stringset_sketch_estimate_intersection(const_sketches, 3);
+    assert_near(5000, estimate, 50000, 0.1);
+    
+    struct stringset_sketch *merged = stringset_sketch_alloc(14);
+    assert(merged);
+    int result = stringset_sketch_merge(merged, sketches[0]);
+    assert(0 == result);
+    result = stringset_sketch_merge(merged, sketches[1]);
+    assert(0 == result);
+    double union_estimate = stringset_sketch_estimate_union(const_sketches, 2);
+    assert(union_estimate == stringset_sketch_estimate(merged));
+    
+    for (int i = 0; i < 3; ++i) stringset_sketch_free(sketches[i]);
+    stringset_sketch_free(merged);
+    stringset_free(first);
+    stringset_free(second);
+    stringset_free(third);
+}
+
+
+void
+test_sketch_estimate(void)
+{
+    test_sketch_estimate_attached();
+    test_sketch_estimate_errors();
+    test_sketch_estimate_union_and_intersection();
+}
@@ -0,0 +1,59 @@
+#include <assert.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+void
+test_stats(void)
+{
+    struct stringset_stats stats;
+    stringset_reset_stats(&stats);
+    stringset_reset_global_stats();
+    
+    struct stringset *set = stringset_alloc();
+    assert(set);
+    int result = stringset_set_stats(set, &stats);
+    assert(0 == result);
+    
+    char const *members[] = {
+        "watermelon", "mango", "apple", "banana", "strawberry"
+    };
+    int members_count = sizeof members / sizeof members[0];
+    result = stringset_add_array(set, members, members_count);
+    assert(0 == result);
+    assert(stringset_contains(set, "mango"));
+    assert(!stringset_contains(set, "kiwi"));
+    result = stringset_remove(set, "mango");
+    assert(0 == result);
+    
+    struct stringset_stats global;
+    stringset_get_global_stats(&global);
+
+#ifdef STRINGSET_STATS
+    assert(1 == stats.calls[stringset_operation_add_array]);
+    assert(0 == stats.calls[stringset_operation_add]);
+    assert(2 == stats.calls[stringset_operation_contains]);
+    assert(1 == stats.calls[stringset_operation_remove]);
+    assert(stats.comparisons > 0);
+    assert(stats.searches >= 3);
+    assert(1 == stats.sorts);
+    assert(stats.reallocations > 0);
+    assert(stats.bytes_allocated > stats.bytes_freed);
+    assert(stats.bytes_freed >= strlen("mango") + 1);
+    
+    assert(global.comparisons >= stats.comparisons);
+    assert(global.calls[stringset_operation_alloc] >= 1);
+#else
+    assert(0 == stats.calls[stringset_operation_add_array]);
+    assert(0 == stats.comparisons);
+    assert(0 == global.comparisons);
+#endif
+    
+    stringset_free(set);
+    
+    assert(0 == strcmp("add", stringset_operation_name(stringset_operation_add)));
+    assert(0 == strcmp("alloc_union",
+                       stringset_operation_name(stringset_operation_alloc_union)));
+    assert(!stringset_operation_name(stringset_operation_count));
+}
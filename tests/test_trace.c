@@ -0,0 +1,139 @@
+#include <assert.h>
+#include <string.h>
+
+#include "stringset.h"
+
+
+struct hook_calls {
+    int begins;
+    int ends;
+    struct stringset_trace_event last_begin;
+    struct stringset_trace_event last_end;
+};
+
+
+static void
+count_begin(struct stringset_trace_event const *event, void *context)
+{
+    struct hook_calls *calls = context;
+    ++calls->begins;
+    calls->last_begin = *event;
+}
+
+
+static void
+count_end(struct stringset_trace_event const *event, void *context)
+{
+    struct hook_calls *calls = context;
+    ++calls->ends;
+    calls->last_end = *event;
+}
+
+
+static unsigned long long
+histogram_total(struct stringset_histogram const *histogram)
+{
+    unsigned long long total = 0;
+    for (int i = 0; i < STRINGSET_HISTOGRAM_BUCKETS; ++i) {
+        total += histogram->counts[i];
+    }
+    return total;
+}
+
+
+static void
+test_trace_histogram_quantile(void)
+{
+    struct stringset_histogram histogram;
+    memset(&histogram, 0, sizeof histogram);
+    assert(0 == stringset_histogram_quantile(&histogram, 0.5));
+    
+    histogram.counts[3] = 50;
+    histogram.counts[8] = 49;
+    histogram.counts[16] = 1;
+    assert(3 == stringset_histogram_quantile(&histogram, 0.0));
+    assert(3 == stringset_histogram_quantile(&histogram, 0.5));
+    assert(8 == stringset_histogram_quantile(&histogram, 0.9));
+    assert(17 == stringset_histogram_quantile(&histogram, 1.0));
+    
+    memset(&histogram, 0, sizeof histogram);
+    histogram.counts[STRINGSET_HISTOGRAM_BUCKETS - 1] = 1;
+    unsigned long long max = stringset_histogram_quantile(&histogram, 1.0);
+    assert((1ULL << 40) - 1 == max);
+    
+    assert(0 == stringset_histogram_quantile(&histogram, 1.5));
+    assert(0 == stringset_histogram_quantile(NULL, 0.5));
+}
+
+
+static void
+test_trace_hooks(void)
+{
+    struct hook_calls calls;
+    memset(&calls, 0, sizeof calls);
+    stringset_reset_histograms();
+    stringset_set_trace_hooks(count_begin, count_end, &calls);
+    
+    char const *members[] = { "apple", "banana", "cherry" };
+    struct stringset *first = stringset_alloc_from_array(members, 3);
+    assert(first);
+    struct stringset *second = stringset_alloc_from_array(members, 2);
+    assert(second);
+    assert(stringset_contains(first, "banana"));
+    assert(stringset_is_superset_of(first, second));
+    
+    stringset_set_trace_hooks(NULL, NULL, NULL);
+    int result = stringset_add(first, "date");
+    assert(0 == result);
+    
+    struct stringset_histogram contains;
+    result = stringset_get_histogram(stringset_operation_contains, &contains);
+    assert(0 == result);
+    struct stringset_histogram is_subset_of;
+    result = stringset_get_histogram(stringset_operation_is_subset_of,
+                                     &is_subset_of);
+    assert(0 == result);
+    struct stringset_histogram add;
+    result = stringset_get_histogram(stringset_operation_add, &add);
+    assert(0 == result);
+
+#ifdef STRINGSET_TRACE
+    assert(4 == calls.begins);
+    assert(4 == calls.ends);
+    assert(stringset_operation_is_superset_of == calls.last_begin.operation);
+    assert(3 == calls.last_begin.count);
+    assert(2 == calls.last_begin.other_count);
+    assert(0 == calls.last_begin.nanoseconds);
+    assert(stringset_operation_is_superset_of == calls.last_end.operation);
+    assert(3 == calls.last_end.count);
+    assert(2 == calls.last_end.other_count);
+    
+    assert(1 == histogram_total(&contains));
+    assert(0 == histogram_total(&is_subset_of));
+    assert(1 == histogram_total(&add));
+#else
+    assert(0 == calls.begins);
+    assert(0 == calls.ends);
+    assert(0 == histogram_total(&contains));
+    assert(0 == histogram_total(&add));
+#endif
+    
+    stringset_reset_histograms();
+    result = stringset_get_histogram(stringset_operation_add, &add);
+    assert(0 == result);
+    assert(0 == histogram_total(&add));
+    
+    result = stringset_get_histogram(stringset_operation_count, &add);
+    assert(-1 == result);
+    
+    stringset_free(first);
+    stringset_free(second);
+}
+
+
+void
+test_trace(void)
+{
+    test_trace_histogram_quantile();
+    test_trace_hooks();
+}